@@ -0,0 +1,21 @@
+#include "PebbleApi.h"
+#include "CivilDate.h"
+
+#define DAYS_IN_ERA 146097
+// Days from 0000-03-01 to 1970-01-01
+#define EPOCH_SHIFT 719468
+
+CivilDate civil_from_days(int32_t days) {
+    days += EPOCH_SHIFT;
+    int32_t era = (days >= 0 ? days : days - DAYS_IN_ERA + 1) / DAYS_IN_ERA;
+    uint32_t day_of_era = days - era * DAYS_IN_ERA;
+    uint32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    uint32_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    uint32_t march_month = (5 * day_of_year + 2) / 153;
+
+    CivilDate date;
+    date.day = day_of_year - (153 * march_month + 2) / 5 + 1;
+    date.month = march_month < 10 ? march_month + 3 : march_month - 9;
+    date.year = (int32_t)year_of_era + era * 400 + (date.month <= 2);
+    return date;
+}
@@ -0,0 +1,24 @@
+/*
+  Conversion from day numbers (days since 1970-01-01) to calendar dates in
+  the proleptic Gregorian calendar.
+
+  It takes a handful of integer operations with no loops or tables, using
+  eras of 400 years (146097 days) that start on March 1st so that the leap
+  day falls at the end of the year. See Howard Hinnant's "chrono-Compatible
+  Low-Level Date Algorithms" for the derivation. Valid for any date a time_t
+  can hold. Day numbers themselves come from DayClock.h, which works them
+  out from the time without going through a calendar date.
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+typedef struct {
+    int32_t year;
+    // 1 to 12
+    uint8_t month;
+    // 1 to 31
+    uint8_t day;
+} CivilDate;
+
+CivilDate civil_from_days(int32_t days);
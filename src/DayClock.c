@@ -0,0 +1,74 @@
+#include "PebbleApi.h"
+#include "DayClock.h"
+
+#define SECONDS_IN_HOUR 3600
+#define SECONDS_IN_DAY 86400
+
+static uint8_t end_of_day;
+static int32_t utc_offset;
+static uint32_t today;
+static time_t next_reset;
+// UTC range the cached values are good for
+static time_t valid_from, valid_until;
+static uint16_t refreshes;
+
+static void refresh(time_t utc) {
+#ifdef PBL_SDK_3
+    struct tm *t = localtime(&utc);
+    utc_offset = t->tm_gmtoff + ((t->tm_isdst > 0) ? SECONDS_IN_HOUR : 0);
+#else
+    // SDK2 uses localtime instead of UTC for all time functions
+    utc_offset = 0;
+#endif
+
+    time_t local = utc + utc_offset;
+    today = (local - end_of_day * SECONDS_IN_HOUR) / SECONDS_IN_DAY;
+    next_reset = (time_t)(today + 1) * SECONDS_IN_DAY + end_of_day * SECONDS_IN_HOUR;
+
+    valid_from = utc - utc % SECONDS_IN_HOUR;
+    valid_until = valid_from + SECONDS_IN_HOUR;
+    if (next_reset - utc_offset < valid_until) {
+        valid_until = next_reset - utc_offset;
+    }
+    refreshes++;
+}
+
+// Returns the UTC time, refreshing the cache if it's out of date. Also covers
+// the clock being set back.
+static time_t check(void) {
+    time_t utc = time(NULL);
+    if (utc < valid_from || utc >= valid_until) {
+        refresh(utc);
+    }
+    return utc;
+}
+
+void day_clock_set_end_of_day(uint8_t hour) {
+    end_of_day = hour;
+    valid_until = 0;
+}
+
+int32_t day_clock_utc_offset() {
+    check();
+    return utc_offset;
+}
+
+time_t day_clock_now() {
+    time_t utc = check();
+    return utc + utc_offset;
+}
+
+uint32_t day_clock_today() {
+    check();
+    return today;
+}
+
+time_t day_clock_next_reset() {
+    check();
+    return next_reset;
+}
+
+// How many times the cache was rebuilt, for debugging
+uint16_t day_clock_refreshes() {
+    return refreshes;
+}
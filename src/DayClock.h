@@ -0,0 +1,22 @@
+/*
+  Cached local time and day boundaries.
+
+  Looking up the UTC offset needs a localtime() call, and the app used to do
+  that (and more) several times per click. The offset, the current day number
+  and the next reset are instead worked out once and reused until the next
+  full hour, which is when daylight saving can change the offset, or until
+  the day ends, whichever comes first.
+
+  All times returned here are local, i.e. UTC plus the offset, like the rest
+  of the app uses. Days start at the end of day hour rather than midnight.
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+void day_clock_set_end_of_day(uint8_t hour);
+int32_t day_clock_utc_offset();
+time_t day_clock_now();
+uint32_t day_clock_today();
+time_t day_clock_next_reset();
+uint16_t day_clock_refreshes();
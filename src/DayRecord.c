@@ -0,0 +1,77 @@
+#include "PebbleApi.h"
+#include "SharedState.h"
+#include "History.h"
+#include "IntakeIndex.h"
+#include "IntakePyramid.h"
+#include "DrinkLog.h"
+#include "IntakeProfile.h"
+#include "DayRecord.h"
+
+typedef struct {
+    uint16_t drinks;
+    int32_t hourly_ml[INTAKE_PROFILE_HOURS];
+} DaySummary;
+
+static void add_drink(const DrinkEvent *event, void *context) {
+    DaySummary *summary = context;
+    if (event->delta_ml > 0) {
+        summary->drinks++;
+    }
+    uint8_t hour = event->minute / 60;
+    if (hour < INTAKE_PROFILE_HOURS) {
+        summary->hourly_ml[hour] += event->delta_ml;
+    }
+}
+
+static uint16_t goal_volume(bool metric, bool half_gallon) {
+    return (metric ? ML_IN_GAL : OZ_IN_GAL) / (half_gallon ? 2 : 1);
+}
+
+static uint16_t intake_oz(uint16_t oz, uint16_t ml, bool metric) {
+    return metric ? ml / EXACT_ML_IN_OZ : oz;
+}
+
+// Empties the drink log into a summary, the profile is added separately
+static void summarize_drinks(DaySummary *summary) {
+    memset(summary, 0, sizeof(*summary));
+    drink_log_compact(add_drink, summary);
+}
+
+// Records the day's intake and returns how many drinks were logged during it
+uint16_t day_record_finish(uint32_t day, uint16_t oz, uint16_t ml, bool metric, bool half_gallon) {
+    history_append(day, history_encode(metric ? ml : oz, goal_volume(metric, half_gallon), metric, half_gallon));
+    intake_index_set(day, intake_oz(oz, ml, metric));
+    intake_pyramid_add_day(day, intake_oz(oz, ml, metric));
+
+    DaySummary summary;
+    summarize_drinks(&summary);
+    intake_profile_add_day(summary.hourly_ml);
+    return summary.drinks;
+}
+
+// Same as day_record_finish(), for callers without the stores open. Each
+// store is opened, written and closed before the next, so only one store's
+// cached pages are on the heap at a time.
+uint16_t day_record_finish_one_at_a_time(uint32_t day, uint16_t oz, uint16_t ml, bool metric, bool half_gallon) {
+    history_init();
+    history_append(day, history_encode(metric ? ml : oz, goal_volume(metric, half_gallon), metric, half_gallon));
+    history_deinit();
+
+    intake_index_init();
+    intake_index_set(day, intake_oz(oz, ml, metric));
+    intake_index_deinit();
+
+    intake_pyramid_init();
+    intake_pyramid_add_day(day, intake_oz(oz, ml, metric));
+    intake_pyramid_deinit();
+
+    DaySummary summary;
+    drink_log_init();
+    summarize_drinks(&summary);
+    drink_log_deinit();
+
+    intake_profile_init();
+    intake_profile_add_day(summary.hourly_ml);
+    intake_profile_deinit();
+    return summary.drinks;
+}
@@ -0,0 +1,15 @@
+/*
+  End of day bookkeeping.
+
+  Adds a finished day to every store that keeps per-day data and empties the
+  drink log into the learned intake profile. Both the app and the background
+  worker roll days over, so this is the one place that knows what a finished
+  day touches. day_record_finish() needs the stores initialized by the
+  caller, day_record_finish_one_at_a_time() opens and closes them itself.
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+uint16_t day_record_finish(uint32_t day, uint16_t oz, uint16_t ml, bool metric, bool half_gallon);
+uint16_t day_record_finish_one_at_a_time(uint32_t day, uint16_t oz, uint16_t ml, bool metric, bool half_gallon);
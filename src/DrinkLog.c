@@ -0,0 +1,94 @@
+#include "PebbleApi.h"
+#include "DrinkLog.h"
+#include "PagedStore.h"
+
+static PagedStore store;
+
+void drink_log_init() {
+    paged_store_init(&store, DRINK_LOG_KEY, DRINK_LOG_PAGES);
+}
+
+void drink_log_deinit() {
+    paged_store_deinit(&store);
+}
+
+void drink_log_flush() {
+    paged_store_flush(&store);
+}
+
+// Makes room for event in a full log by merging the two events closest in
+// time, which keeps the hours the day's drinks were spread over. The merged
+// event keeps the time of the larger change.
+static void append_to_full_log(const DrinkEvent *event) {
+    DrinkEvent events[DRINK_LOG_PAGES * PAGED_STORE_PAGE_SIZE / sizeof(DrinkEvent) + 1];
+    uint32_t start = paged_store_start(&store);
+    uint16_t count = (paged_store_length(&store) - start) / sizeof(DrinkEvent);
+    if (count + 1 > ARRAY_LENGTH(events) ||
+            paged_store_read(&store, start, events, count * sizeof(DrinkEvent)) != count * sizeof(DrinkEvent)) {
+        return;
+    }
+    events[count++] = *event;
+
+    // Events are logged in order, so the closest two are next to each other.
+    // Only events in the same hour are merged, so that every drink stays in
+    // the hour the profile learns it in. More events than there are hours in
+    // a day always have such a pair. Ties go to the newest pair.
+    int16_t closest = -1;
+    for (uint16_t i = 0; i + 1 < count; i++) {
+        if (events[i + 1].minute / 60 == events[i].minute / 60 && (closest < 0 ||
+                events[i + 1].minute - events[i].minute <= events[closest + 1].minute - events[closest].minute)) {
+            closest = i;
+        }
+    }
+    if (closest < 0) {
+        return;
+    }
+
+    DrinkEvent *merged = &events[closest], *next = &events[closest + 1];
+    if (abs(next->delta_ml) > abs(merged->delta_ml)) {
+        merged->minute = next->minute;
+    }
+    merged->delta_ml += next->delta_ml;
+    memmove(next, next + 1, (count - closest - 2) * sizeof(DrinkEvent));
+    count--;
+    paged_store_write(&store, start + closest * sizeof(DrinkEvent), merged, (count - closest) * sizeof(DrinkEvent));
+}
+
+// Records a change in volume, merging it into the last event if that was in
+// the same minute. Only ever touches the newest page.
+void drink_log_append(uint16_t minute, int16_t delta_ml) {
+    uint32_t end = paged_store_length(&store);
+    DrinkEvent last;
+    if (end - paged_store_start(&store) >= sizeof(DrinkEvent) &&
+            paged_store_read(&store, end - sizeof(DrinkEvent), &last, sizeof(last)) == sizeof(last) &&
+            last.minute == minute) {
+        last.delta_ml += delta_ml;
+        paged_store_write(&store, end - sizeof(DrinkEvent), &last, sizeof(last));
+        return;
+    }
+
+    DrinkEvent event = { .minute = minute, .delta_ml = delta_ml };
+    if (end + sizeof(DrinkEvent) > paged_store_capacity(&store)) {
+        append_to_full_log(&event);
+        return;
+    }
+    paged_store_write(&store, end, &event, sizeof(event));
+}
+
+// Events logged since the last compaction
+uint16_t drink_log_count() {
+    return (paged_store_length(&store) - paged_store_start(&store)) / sizeof(DrinkEvent);
+}
+
+// Hands every event to visitor, oldest first, then empties the log so the
+// next day starts again on its first page
+void drink_log_compact(DrinkLogVisitor visitor, void *context) {
+    uint32_t end = paged_store_length(&store);
+    for (uint32_t offset = paged_store_start(&store); offset + sizeof(DrinkEvent) <= end; offset += sizeof(DrinkEvent)) {
+        DrinkEvent event;
+        if (paged_store_read(&store, offset, &event, sizeof(event)) == sizeof(event)) {
+            visitor(&event, context);
+        }
+    }
+    paged_store_clear(&store);
+}
@@ -0,0 +1,32 @@
+/*
+  Append-only log of today's drinks.
+
+  Every click that changes the day's volume is recorded as a 4 byte event:
+  the minute since the day started and the signed change in mL. Clicks within
+  the same minute are merged into one event so that repeated clicks don't use
+  up the log. The log holds DRINK_LOG_PAGES * 64 events. Once it is full, the
+  two closest events within the same hour are merged to make room. A busy
+  day loses detail within its hours, but every drink stays in the hour it
+  was logged in. When the day is over the log is compacted, handing each
+  event to a visitor once and releasing the pages it used.
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+#define DRINK_LOG_KEY 3040
+#define DRINK_LOG_PAGES 1
+
+typedef struct __attribute__((__packed__)) {
+    uint16_t minute;
+    int16_t delta_ml;
+} DrinkEvent;
+
+typedef void (*DrinkLogVisitor)(const DrinkEvent *event, void *context);
+
+void drink_log_init();
+void drink_log_deinit();
+void drink_log_flush();
+void drink_log_append(uint16_t minute, int16_t delta_ml);
+uint16_t drink_log_count();
+void drink_log_compact(DrinkLogVisitor visitor, void *context);
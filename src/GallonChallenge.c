@@ -1,14 +1,32 @@
 #include <pebble.h>
-#include "PDUtils.h"
+#include "SharedState.h"
+#include "StateStore.h"
+#include "History.h"
+#include "Streaks.h"
+#include "IntakeIndex.h"
+#include "IntakePyramid.h"
+#include "DrinkLog.h"
+#include "IntakeProfile.h"
+#include "DayClock.h"
+#include "CivilDate.h"
+#include "WakeupPlanner.h"
+#include "ReminderPlan.h"
+#include "DayRecord.h"
+#include "GlyphAtlas.h"
+#include "src/fill_table.auto.h"
 #include "GallonChallenge.h"
 
 static Window *main_window, *custom_drink_unit_window;
 
-static GBitmap *action_icon_plus, *action_icon_settings, *action_icon_check, *action_icon_minus, *gallon_filled_image, *gallon_image, *star;
+static GBitmap *action_icon_plus, *action_icon_snooze, *action_icon_settings, *action_icon_check, *action_icon_minus, *gallon_filled_image, *gallon_image, *star;
 
 static ActionBarLayer *action_bar;
-static TextLayer *streak_text_layer, *text_layer, *white_layer, *notify_text_layer, *CDU_header_text_layer, *CDU_text_layer;
-static BitmapLayer *gallon_filled_layer, *gallon_layer, *star_layer;
+static TextLayer *streak_text_layer, *notify_text_layer, *CDU_header_text_layer, *CDU_text_layer;
+static BitmapLayer *star_layer;
+static Layer *container_layer, *counter_layer, *atlas_layer;
+// The counter is drawn from pre-rendered glyphs, see counter_update_proc()
+static GlyphAtlas counter_atlas;
+static char volume_text[20];
 
 static UnitSystem unit_system;
 static Unit goal, unit;
@@ -16,50 +34,67 @@ static Unit goal, unit;
 static time_t current_date, last_streak_date, drinking_since;
 static uint8_t current_oz, start_of_day, end_of_day, inactivity_reminder_hours, temp_cdu_oz, cdu_oz;
 static uint16_t current_ml, streak_count, longest_streak, temp_cdu_ml, cdu_ml;
-static uint16_t total_consumed;
-
-static WakeupId wakeup_reminder_id, wakeup_reset_id;
-
-static AppTimer *quit_timer, *reset_reminder_timer, *remove_notify_timer;
-
-static bool launched = false;
+static uint32_t total_consumed;
+// Drinks logged over days_logged finished days, for the profile's average
+static uint32_t total_drinks;
+static uint16_t days_logged;
+// Reminder backoff and snooze, plus counters for how reminders are received
+static uint8_t ignored_reminders;
+static time_t snoozed_until;
+static uint16_t reminders_shown, reminders_vibrated, reminders_answered;
+
+// Profile statistics, see profile_menu_update_stats()
+static uint32_t last_7_days_oz, last_30_days_oz, last_365_days_oz;
+static uint16_t best_week_oz, worst_week_oz;
+static bool has_full_week;
+
+static AppTimer *click_frame_timer, *click_burst_timer, *remove_notify_timer, *save_timer;
+// Clicks not applied yet, see queue_volume_change()
+static int8_t pending_units = 0;
+
+// Changes are written back at most once per SAVE_INTERVAL_MS, plus on exit
+static bool state_dirty = false;
+#ifdef GALLON_STATS
+static uint16_t persist_writes_avoided = 0;
+// Repeating clicks often change nothing on screen, e.g. once the goal is
+// reached or while the water stays on the same row, see update_volume_display()
+static uint16_t container_redraws = 0, redraws_avoided = 0;
+#endif
+
+// Set when the app was only launched to start a new day, see init()
+static bool headless = false;
 
 static uint8_t width, x_shift, y_shift, chalk_shift;
-
-
-static uint8_t half_gallon_height(float v) {
-    if (unit_system == CUSTOMARY) {
-        return -2.648947948*10e-7*v*v*v*v + 1.57399393*10e-5*v*v*v - 3.197706522*10e-5*v*v - 1.227965142*v + 84.21612388;
-    } else {
-        return -2.777623239*10e-13*v*v*v*v + 5.157663293*10e-10*v*v*v - 3.27445129*10e-8*v*v - 3.929488456*10e-3*v + 84.21612388;
-    }
-}
-
-static uint8_t gallon_height(float v) {
-    if (unit_system == CUSTOMARY) {
-        return -1.308363868*10e-8*v*v*v*v + 3.373611245*10e-7*v*v*v + 1.708355542*10e-4*v*v - 6.136166056*10e-2*v + 81.11469866;
-    } else {
-        return -1.371918968*10e-14*v*v*v*v + 1.105465059*10e-11*v*v*v + 1.749356045*10e-7*v*v - 1.963573136*10e-3*v + 81.11469866;
-    }
-}
-
-static uint8_t container_height(float vol) {
-    if (vol == 0) {
-        return 93;
-    }
-    
-    if (vol >= get_goal_vol(unit_system)) {
-        return 0;
-    }
-    
-    switch (goal) {
-        case HALF_GALLON:
-            return half_gallon_height(vol);
-            break;
+// Water line of the container as last invalidated, -1 to force a redraw
+static int16_t water_top = -1;
+
+// Values derived from the settings and today's volume. Each one is only
+// recomputed by refresh_derived() once an input it depends on was marked
+// changed, see mark_derived_dirty().
+static uint8_t derived_dirty = DIRTY_ALL;
+static struct {
+    uint16_t goal_oz, goal_ml;
+    bool goal_met;
+    // Today's progress counted in the drinking unit, e.g. 3 of 16 cups
+    uint16_t volume, goal_units;
+    const char *unit_label;
+    char text[20];
+    int16_t water_top;
+    // Units the auto reminders aim for, see get_reminder_times()
+    float reminder_units_done, reminder_units_goal;
+} derived;
+
+
+// Fill heights come from lookup tables generated at build time from the
+// container bitmaps, see tools/fill_table.py. vol must not be past the goal.
+static uint8_t container_height(uint16_t vol) {
+    switch (unit_system) {
+        case METRIC:
+            vol /= FILL_TABLE_ML_STEP;
+            return (goal == HALF_GALLON) ? HALF_GALLON_ML_FILL_TABLE[vol] : GALLON_ML_FILL_TABLE[vol];
             
         default:
-            return gallon_height(vol);
-            break;
+            return (goal == HALF_GALLON) ? HALF_GALLON_OZ_FILL_TABLE[vol] : GALLON_OZ_FILL_TABLE[vol];
     }
 }
 
@@ -160,111 +195,40 @@ static const char* reminder_to_string(uint8_t hour) {
     }
 }
 
+// Dates are local times that have been shifted back by the end of day hour
 static bool are_dates_equal(time_t date1, time_t date2) {
-    #ifdef PBL_SDK_3
-        struct tm *old_date = gmtime(&date1);
-    #else
-        struct tm *old_date = localtime(&date1);
-    #endif
-    uint16_t old_mday = old_date->tm_mday;
-    uint16_t old_mon = old_date->tm_mon;
-    uint16_t old_year = old_date->tm_year;
-    
-    #ifdef PBL_SDK_3
-        struct tm *new_date = gmtime(&date2);
-    #else
-        struct tm *new_date = localtime(&date2);
-    #endif
-    uint16_t new_mday = new_date->tm_mday;
-    uint16_t new_mon = new_date->tm_mon;
-    uint16_t new_year = new_date->tm_year;
-    
-    if (old_mday == new_mday && old_mon == new_mon && old_year == new_year) {
-        return true;
-    }
-    
-    return false;
+    return date1 / SEC_IN_DAY == date2 / SEC_IN_DAY;
 }
 
 static bool should_vibrate() {
-    // Get the current hour
-    time_t current_time = now();
-    // APP_LOG(APP_LOG_LEVEL_DEBUG, "Now: %d", (int)current_time);
-    #ifdef PBL_SDK_3
-        struct tm *time_struct = gmtime(&current_time);
-    #else
-        struct tm *time_struct = localtime(&current_time);
-    #endif
-    uint8_t hour = time_struct->tm_hour;
-    // APP_LOG(APP_LOG_LEVEL_DEBUG, "Original Hour: %d", hour);
-
-    // Make adjustments to be able to calculate the silent hours
-    // APP_LOG(APP_LOG_LEVEL_DEBUG, "UTC Offset: %d", (int)get_UTC_offset(NULL));
-    uint8_t start_silent = (end_of_day + 24 - 2) % 24;
-    // APP_LOG(APP_LOG_LEVEL_DEBUG, "Start silent: %d", start_silent);
-    uint8_t end_silent = (start_of_day + 24) % 24;
-    // APP_LOG(APP_LOG_LEVEL_DEBUG, "End silent: %d", end_silent);
-    if (start_silent > end_silent) {
-        end_silent += 24;
-    }
-    // APP_LOG(APP_LOG_LEVEL_DEBUG, "End silent: %d", end_silent);
-    if (hour < start_silent) {
-        hour += 24;
-    }
-    // APP_LOG(APP_LOG_LEVEL_DEBUG, "Modified Hour: %d", hour);
-
-    // Whether the hour is inside the silent hours
-    if (hour >= start_silent && hour <= end_silent) {
-        return false;
-    }
-    return true;
+    return !wakeup_planner_is_quiet(now() - day_clock_utc_offset());
 }
 
-// Gets the UTC offset of the local time in seconds 
-// (pass in an existing localtime struct tm to save creating another one, or else pass NULL)
-time_t get_UTC_offset(struct tm *t) {
-#ifdef PBL_SDK_3
-  if (t == NULL) {
-    time_t temp;
-    temp = time(NULL);
-    t = localtime(&temp);
-  }
-  
-  return t->tm_gmtoff + ((t->tm_isdst > 0) ? 3600 : 0);
-#else
-  // SDK2 uses localtime instead of UTC for all time functions so always return 0
-  return 0; 
-#endif 
+// Reminders are silent from two hours before the end of the day until the
+// start of the day, inclusive, as a mask of local hours
+static uint32_t get_quiet_hours() {
+    uint32_t hours = 0;
+    uint8_t hour = (end_of_day + 24 - 2) % 24;
+    while (true) {
+        hours |= 1 << hour;
+        if (hour == start_of_day % 24) {
+            break;
+        }
+        hour = (hour + 1) % 24;
+    }
+    return hours;
 }
 
 static time_t now() {
-    return time(NULL) + get_UTC_offset(NULL);
+    return day_clock_now();
 }
 
 static time_t get_todays_date() {
     return now() - end_of_day * SEC_IN_HOUR;
 }
 
-static time_t get_yesterdays_date() {
-    return now() - end_of_day * SEC_IN_HOUR - SEC_IN_DAY;
-}
-
 static time_t get_next_reset_time() {
-    time_t current_time = now();
-
-    // Set the reset time to be at the "end of day" of the current day
-    struct tm *reset_time_struct = localtime(&current_time);
-    reset_time_struct->tm_hour = end_of_day;
-    reset_time_struct->tm_min = 0;
-    reset_time_struct->tm_sec = 0;
-
-    // If the reset time is earlier than the current time, add a day to reset time
-    time_t reset_time = p_mktime(reset_time_struct);
-    while ((int)reset_time < (int)current_time) {
-        reset_time += SEC_IN_DAY;
-    }
-
-    return reset_time;
+    return day_clock_next_reset();
 }
 
 static float hours_left_in_day() {
@@ -277,32 +241,53 @@ static float hours_left_in_day() {
 }
 
 static bool reset_current_date_and_volume_if_needed() {
-    bool reset = false;
-
-    time_t today = get_todays_date();
-    time_t yesterday = get_yesterdays_date();
-    if (!are_dates_equal(current_date, today)) {
-        current_date = today;
-        current_oz = 0;
-        current_ml = 0;
-        reset_reminder();
-        reset = true;
-        
-        // Reset the streak if needed
-        if (!are_dates_equal(last_streak_date, yesterday)) {
-            if (streak_count > longest_streak) {
-                longest_streak = streak_count;
-            }
-            streak_count = 0;
-        }
-    }
+    bool reset = roll_over_day_if_needed();
     
     update_streak_count();
+    update_streak_display();
     update_volume_display();
 
     return reset;
 }
 
+// Starts a new day if the current one is over. Doesn't touch the UI, so it
+// can run without the main window.
+static bool roll_over_day_if_needed() {
+    time_t today = get_todays_date();
+    if (are_dates_equal(current_date, today)) {
+        return false;
+    }
+
+    record_finished_day();
+    current_date = today;
+    current_oz = 0;
+    current_ml = 0;
+    mark_derived_dirty(DIRTY_DAY | DIRTY_VOLUME);
+    reset_reminder();
+    mark_state_dirty();
+    return true;
+}
+
+// Adds the day that is ending (current_date) to the history
+static void record_finished_day() {
+    total_drinks += day_record_finish(current_date / SEC_IN_DAY, current_oz, current_ml,
+        unit_system == METRIC, goal == HALF_GALLON);
+    days_logged++;
+}
+
+// Adds the change in volume since before_ml to today's drink log
+static void log_drink(uint16_t before_ml) {
+    int16_t delta_ml = (int16_t)current_ml - (int16_t)before_ml;
+    if (delta_ml != 0) {
+        drink_log_append((get_todays_date() % SEC_IN_DAY) / 60, delta_ml);
+    }
+}
+
+// Today's intake in ounces, whatever the unit system
+static uint16_t get_current_oz() {
+    return (unit_system == CUSTOMARY) ? current_oz : current_ml / EXACT_ML_IN_OZ;
+}
+
 // Uses the current_oz/current_ml and the chosen display unit to calculate the 
 // volume of liquid consumed in the current day
 static uint16_t calc_current_volume() {
@@ -367,13 +352,96 @@ static float get_goal_scale() {
 }
 
 static uint16_t get_goal_vol(UnitSystem us) {
+    refresh_derived();
     switch (us) {
-        case CUSTOMARY: return OZ_IN_GAL * get_goal_scale();
-        case METRIC:    return ML_IN_GAL * get_goal_scale();
+        case CUSTOMARY: return derived.goal_oz;
+        case METRIC:    return derived.goal_ml;
         default:        return 0;
     }
 }
 
+static void mark_derived_dirty(uint8_t inputs) {
+    derived_dirty |= inputs;
+}
+
+// Recomputes the derived values whose inputs changed since the last call
+static void refresh_derived() {
+    uint8_t dirty = derived_dirty;
+    if (dirty == 0) {
+        return;
+    }
+    derived_dirty = 0;
+
+    if (dirty & DIRTY_GOAL) {
+        derived.goal_oz = OZ_IN_GAL * get_goal_scale();
+        derived.goal_ml = ML_IN_GAL * get_goal_scale();
+    }
+
+    if (dirty & (DIRTY_GOAL | DIRTY_UNIT | DIRTY_UNIT_SYSTEM)) {
+        derived.goal_units = get_unit_in_gal(false) * get_goal_scale();
+        // Ounces needs to be abbreviated to not be cut off
+        if (unit_system != CUSTOMARY) {
+            derived.unit_label = "mL";
+        } else if (unit == OUNCE || unit == CUSTOM) {
+            derived.unit_label = "oz";
+        } else {
+            derived.unit_label = unit_to_string(unit);
+        }
+
+        derived.reminder_units_goal = get_unit_in_gal(true) * get_goal_scale();
+        // If using the metric unit system, scale the amount by drinking unit
+        if (unit_system == METRIC && unit != CUSTOM) {
+            derived.reminder_units_goal /= get_ml_in(unit);
+        }
+    }
+
+    if (dirty & (DIRTY_VOLUME | DIRTY_UNIT | DIRTY_UNIT_SYSTEM)) {
+        derived.volume = calc_current_volume();
+
+        uint16_t current_volume_scalar = 1;
+        if (unit == CUSTOM) {
+            current_volume_scalar = (unit_system == CUSTOMARY) ? cdu_oz : cdu_ml;
+        }
+        derived.reminder_units_done = derived.volume / current_volume_scalar;
+        if (unit_system == METRIC && unit != CUSTOM) {
+            derived.reminder_units_done /= get_ml_in(unit);
+        }
+    }
+
+    if (dirty & (DIRTY_VOLUME | DIRTY_GOAL | DIRTY_UNIT_SYSTEM)) {
+        uint16_t vol = (unit_system == CUSTOMARY) ? current_oz : current_ml;
+        uint16_t goal_vol = (unit_system == CUSTOMARY) ? derived.goal_oz : derived.goal_ml;
+        derived.goal_met = vol >= goal_vol;
+        derived.water_top = FILL_TABLE_MASK_TOP + (derived.goal_met ? 0 : container_height(vol));
+    }
+
+    if (dirty & (DIRTY_VOLUME | DIRTY_GOAL | DIRTY_UNIT | DIRTY_UNIT_SYSTEM)) {
+        snprintf(derived.text, sizeof(derived.text), "%u/%u %s", derived.volume, derived.goal_units,
+            derived.unit_label);
+    }
+}
+
+// Brings everything that depends on the changed inputs up to date after a
+// settings change, replacing the mix of updates each handler used to run
+static void state_changed(uint8_t inputs) {
+    mark_derived_dirty(inputs);
+    mark_state_dirty();
+
+    if (inputs & DIRTY_GOAL) {
+        set_image_for_goal();
+    }
+    if (inputs & (DIRTY_VOLUME | DIRTY_GOAL | DIRTY_UNIT_SYSTEM | DIRTY_DAY)) {
+        update_streak_count();
+        update_streak_display();
+    }
+    update_volume_display();
+    if (inputs & (DIRTY_GOAL | DIRTY_UNIT | DIRTY_UNIT_SYSTEM | DIRTY_DAY)) {
+        reset_reminder();
+    } else if (inputs & DIRTY_VOLUME) {
+        schedule_reminder_if_needed();
+    }
+}
+
 static void set_image_for_goal() {
     // Free the old image before creating the new image
     gbitmap_destroy(gallon_filled_image);
@@ -390,33 +458,99 @@ static void set_image_for_goal() {
             break;
     }
     
-    bitmap_layer_set_bitmap(gallon_filled_layer, gallon_filled_image);
-    bitmap_layer_set_bitmap(gallon_layer, gallon_image);
+    water_top = -1;
+    layer_mark_dirty(container_layer);
 }
 
-static void update_volume_display() {
-    static char body_text[20];
-    
-    uint16_t numerator = calc_current_volume();
-    uint16_t denominator = get_unit_in_gal(false) * get_goal_scale();
+// Draws rows top to bottom of a bitmap where they'd be if it was drawn whole
+static void draw_bitmap_rows(GContext *ctx, GBitmap *bitmap, int16_t top, int16_t bottom) {
+    if (top >= bottom) {
+        return;
+    }
+    GRect full = gbitmap_get_bounds(bitmap);
+    gbitmap_set_bounds(bitmap, GRect(full.origin.x, full.origin.y + top, full.size.w, bottom - top));
+    graphics_draw_bitmap_in_rect(ctx, bitmap, GRect(0, top, full.size.w, bottom - top));
+    gbitmap_set_bounds(bitmap, full);
+}
 
-    // Ounces needs to be abbreviated to not be cut off
-    const char* unit_string = unit_to_string(unit);
-    if (strcmp(unit_string, "Ounces") == 0) unit_string = "oz";
+// Row of the container where the water starts
+static int16_t get_water_top() {
+    refresh_derived();
+    return derived.water_top;
+}
 
-    snprintf(body_text, sizeof(body_text), "%u/%u %s", numerator, denominator, 
-        (unit_system == CUSTOMARY) ? unit_string : "mL");
-    text_layer_set_text(text_layer, body_text);
+// The filled image is only drawn below the water line, where the window's
+// white background shows through above it, and the outline goes on top
+static void container_update_proc(Layer *layer, GContext *ctx) {
+    GRect bounds = layer_get_bounds(layer);
+    int16_t top = get_water_top();
+    if (top > bounds.size.h) top = bounds.size.h;
+    STATS_COUNT(container_redraws);
+
+    draw_bitmap_rows(ctx, gallon_filled_image, 0, FILL_TABLE_MASK_TOP);
+    draw_bitmap_rows(ctx, gallon_filled_image, top, bounds.size.h);
+
+    graphics_context_set_compositing_mode(ctx, GCompOpClear);
+    graphics_draw_bitmap_in_rect(ctx, gallon_image, bounds);
+}
+
+// Today's progress, e.g. "3/16 Cups"
+static const char* get_volume_text() {
+    refresh_derived();
+    return derived.text;
+}
+
+static bool is_goal_met() {
+    refresh_derived();
+    return derived.goal_met;
+}
+
+static void update_volume_display() {
+    // Only what actually changed is invalidated
+    const char *text = get_volume_text();
+    if (strcmp(text, volume_text) != 0) {
+        strcpy(volume_text, text);
+        // A new unit may need glyphs that weren't rendered yet
+        glyph_atlas_add_glyphs(&counter_atlas, volume_text);
+        layer_mark_dirty(counter_layer);
+    } else {
+        STATS_COUNT(redraws_avoided);
+    }
     
-    uint8_t height = container_height((unit_system == CUSTOMARY) ? current_oz : current_ml);
-    layer_set_frame(text_layer_get_layer(white_layer), GRect(0, 34 + y_shift, width, height));
+    int16_t top = get_water_top();
+    if (top != water_top) {
+        water_top = top;
+        layer_mark_dirty(container_layer);
+    } else {
+        STATS_COUNT(redraws_avoided);
+    }
 
     // Only show the star if the goal is met
     bool is_star_visible = !layer_get_hidden(bitmap_layer_get_layer(star_layer));
-    if (numerator == denominator && !is_star_visible) {
-        layer_set_hidden(bitmap_layer_get_layer(star_layer), false);
-    } else if (numerator != denominator && is_star_visible) {
-        layer_set_hidden(bitmap_layer_get_layer(star_layer), true);
+    if (is_goal_met() != is_star_visible) {
+        layer_set_hidden(bitmap_layer_get_layer(star_layer), is_star_visible);
+    }
+}
+
+// Drawn first so that the glyphs can be rendered on a clean frame buffer. If
+// that fails, the counter draws its text directly until a new glyph is needed.
+static void atlas_update_proc(Layer *layer, GContext *ctx) {
+    if (glyph_atlas_needs_render(&counter_atlas)) {
+        glyph_atlas_render(&counter_atlas, ctx, layer_get_frame(layer));
+    }
+}
+
+// Blitting glyphs skips laying the text out on every click. Text the atlas
+// can't draw falls back to drawing it directly.
+static void counter_update_proc(Layer *layer, GContext *ctx) {
+    GRect bounds = layer_get_bounds(layer);
+    if (glyph_atlas_covers(&counter_atlas, volume_text)) {
+        int16_t text_width = glyph_atlas_text_width(&counter_atlas, volume_text);
+        glyph_atlas_draw_text(&counter_atlas, ctx, volume_text, GPoint((bounds.size.w - text_width) / 2, 0));
+    } else {
+        graphics_context_set_text_color(ctx, GColorBlack);
+        graphics_draw_text(ctx, volume_text, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD), bounds,
+            GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
     }
 }
 
@@ -426,41 +560,109 @@ static void update_streak_display() {
     text_layer_set_text(streak_text_layer, streak_text);
 }
 
-// Increase the current volume by one unit
-static void increment_volume() {
-    uint16_t oz_vol_inc, ml_vol_inc;
+// Clicks only add up here. They're applied at most once per CLICK_FRAME_MS,
+// and the updates that depend on the day's total (streak, reminders and
+// saving) wait until the clicks have stopped for CLICK_BURST_MS.
+static void queue_volume_change(int8_t units) {
+    pending_units += units;
+    if (!click_frame_timer) {
+        click_frame_timer = app_timer_register(CLICK_FRAME_MS, apply_pending_units, NULL);
+    }
+    if (!click_burst_timer || !app_timer_reschedule(click_burst_timer, CLICK_BURST_MS)) {
+        click_burst_timer = app_timer_register(CLICK_BURST_MS, finish_click_burst, NULL);
+    }
+}
+
+static void apply_pending_units() {
+    click_frame_timer = NULL;
+    for (; pending_units > 0; pending_units--) {
+        add_unit_volume();
+    }
+    for (; pending_units < 0; pending_units++) {
+        remove_unit_volume();
+    }
+    update_volume_display();
+}
+
+// The goal is only checked here, so a burst that reaches it (or goes back
+// under it) changes the streak once
+static void finish_click_burst() {
+    click_burst_timer = NULL;
+    mark_state_dirty();
+    update_streak_count();
+    update_streak_display();
+    schedule_reminder_if_needed();
+}
+
+// Applies any clicks still waiting, before the main window goes away or
+// something else reads the volume
+static void flush_clicks() {
+    if (click_frame_timer) {
+        app_timer_cancel(click_frame_timer);
+        apply_pending_units();
+    }
+    if (click_burst_timer) {
+        app_timer_cancel(click_burst_timer);
+        finish_click_burst();
+    }
+}
+
+// Logs one drinking unit without touching the UI
+static void add_one_unit() {
+    add_unit_volume();
+    mark_state_dirty();
+    update_streak_count();
+}
+
+// The size of one drinking unit in both unit systems
+static void get_unit_volume(uint16_t *oz, uint16_t *ml) {
     switch (unit) {
         case CUP:
-            oz_vol_inc = OZ_IN_CUP;
-            ml_vol_inc = ML_IN_CUP;
+            *oz = OZ_IN_CUP;
+            *ml = ML_IN_CUP;
             break;
         case PINT:
-            oz_vol_inc = OZ_IN_PINT;
-            ml_vol_inc = ML_IN_PINT;
+            *oz = OZ_IN_PINT;
+            *ml = ML_IN_PINT;
             break;
         case QUART:
-            oz_vol_inc = OZ_IN_QUART;
-            ml_vol_inc = ML_IN_QUART;
+            *oz = OZ_IN_QUART;
+            *ml = ML_IN_QUART;
             break;
         case CUSTOM:
-            oz_vol_inc = cdu_oz;
-            ml_vol_inc = cdu_ml;
+            *oz = cdu_oz;
+            *ml = cdu_ml;
             break;
         default:
-            oz_vol_inc = 1;
-            ml_vol_inc = ML_IN_OZ;
+            *oz = 1;
+            *ml = ML_IN_OZ;
             break;
     }
 
     // Make the conversion more exact
-    oz_vol_inc = (unit_system == CUSTOMARY) ? oz_vol_inc : (int)((float)ml_vol_inc / EXACT_ML_IN_OZ);
-    ml_vol_inc = (unit_system == METRIC) ? ml_vol_inc : (int)((float)oz_vol_inc * EXACT_ML_IN_OZ);
+    *oz = (unit_system == CUSTOMARY) ? *oz : (int)((float)*ml / EXACT_ML_IN_OZ);
+    *ml = (unit_system == METRIC) ? *ml : (int)((float)*oz * EXACT_ML_IN_OZ);
+}
+
+// Restrict the max volumes to the goal volumes
+static void clamp_volume_to_goal() {
+    if (current_oz > get_goal_vol(CUSTOMARY) || current_ml > get_goal_vol(METRIC)) {
+        if (current_oz > get_goal_vol(CUSTOMARY)) current_oz = get_goal_vol(CUSTOMARY);
+        if (current_ml > get_goal_vol(METRIC)) current_ml = get_goal_vol(METRIC);
+        mark_derived_dirty(DIRTY_VOLUME);
+    }
+}
+
+// Increase the current volume by one unit
+static void add_unit_volume() {
+    uint16_t oz_vol_inc, ml_vol_inc;
+    get_unit_volume(&oz_vol_inc, &ml_vol_inc);
     
     // maybe not needed
     uint16_t oz_in_goal, ml_in_goal;
     switch (unit_system) {
         case CUSTOMARY:
-            oz_in_goal = OZ_IN_GAL * get_goal_scale();
+            oz_in_goal = get_goal_vol(CUSTOMARY);
             if (current_oz + oz_vol_inc > oz_in_goal) {
                 total_consumed += oz_in_goal - current_oz;
             } else if (current_oz < oz_in_goal) {
@@ -468,7 +670,7 @@ static void increment_volume() {
             }
             break;
         case METRIC:
-            ml_in_goal = ML_IN_GAL * get_goal_scale();
+            ml_in_goal = get_goal_vol(METRIC);
             if (current_ml + ml_vol_inc > ml_in_goal) {
                 total_consumed += (ml_in_goal - current_ml) / EXACT_ML_IN_OZ;
             } else if (current_ml < ml_in_goal) {
@@ -479,47 +681,21 @@ static void increment_volume() {
             break;
     }
 
+    uint16_t before_ml = current_ml;
     current_oz += oz_vol_inc;
     current_ml += ml_vol_inc;
-    
-    update_streak_count();
-    update_volume_display();
-
-    // In case of repeating clicks, don't immediately reset the reminder
-    app_timer_cancel(reset_reminder_timer);
-    reset_reminder_timer = app_timer_register(666, reset_reminder, NULL);
+    mark_derived_dirty(DIRTY_VOLUME);
+    clamp_volume_to_goal();
+    // Drinking is what reminders are for, so they go back to their usual pace
+    ignored_reminders = 0;
+    snoozed_until = 0;
+    log_drink(before_ml);
 }
 
 // Decrease the current volume by one unit
-static void decrement_volume() {
+static void remove_unit_volume() {
     uint16_t oz_vol_dec, ml_vol_dec;
-    
-    switch (unit) {
-        case CUP:
-            oz_vol_dec = OZ_IN_CUP;
-            ml_vol_dec = ML_IN_CUP;
-            break;
-        case PINT:
-            oz_vol_dec = OZ_IN_PINT;
-            ml_vol_dec = ML_IN_PINT;
-            break;
-        case QUART:
-            oz_vol_dec = OZ_IN_QUART;
-            ml_vol_dec = ML_IN_QUART;
-            break;
-        case CUSTOM:
-            oz_vol_dec = cdu_oz;
-            ml_vol_dec = cdu_ml;
-            break;
-        default:
-            oz_vol_dec = 1;
-            ml_vol_dec = ML_IN_OZ;
-            break;
-    }
-
-    // Make the conversion more exact
-    oz_vol_dec = (unit_system == CUSTOMARY) ? oz_vol_dec : (int)((float)ml_vol_dec / EXACT_ML_IN_OZ);
-    ml_vol_dec = (unit_system == METRIC) ? ml_vol_dec : (int)((float)oz_vol_dec * EXACT_ML_IN_OZ);
+    get_unit_volume(&oz_vol_dec, &ml_vol_dec);
     
     // maybe not needed
     switch (unit_system) {
@@ -533,73 +709,100 @@ static void decrement_volume() {
             break;
     }
 
+    uint16_t before_ml = current_ml;
     (current_oz < oz_vol_dec) ? (current_oz = 0) : (current_oz -= oz_vol_dec);
     (current_ml < ml_vol_dec) ? (current_ml = 0) : (current_ml -= ml_vol_dec);
-    
-    update_streak_count();
-    update_volume_display();
-
-    // In case of repeating clicks, don't immediately reset the reminder
-    app_timer_cancel(reset_reminder_timer);
-    reset_reminder_timer = app_timer_register(666, reset_reminder, NULL);
+    mark_derived_dirty(DIRTY_VOLUME);
+    log_drink(before_ml);
 }
 
 static void update_streak_count() {
-    // Restrict the max volumes to the goal volumes
-    if (current_oz >= get_goal_vol(CUSTOMARY)) current_oz = get_goal_vol(CUSTOMARY);
-    if (current_ml >= get_goal_vol(METRIC)) current_ml = get_goal_vol(METRIC);
+    clamp_volume_to_goal();
 
-    uint16_t goal_vol = get_goal_vol(unit_system);
-    uint16_t current_vol = (unit_system == CUSTOMARY) ? current_oz : current_ml;
-    time_t today = get_todays_date();
+    uint32_t today = day_clock_today();
     
-    if (current_vol >= goal_vol) {
-        // If the last streak date is not today's date, then set that date to
-        // today's date and increment the streak count.
-        if (!are_dates_equal(last_streak_date, today)) {
-            last_streak_date = today;
-            streak_count++;
-        }
-    } else if (current_vol < goal_vol && are_dates_equal(last_streak_date, today)) {
-        // If the last streak date is today's date, since the goal is now no longer
-        // met, set the last streak date to the previous date and decrement the
-        // streak count.
-        last_streak_date = get_yesterdays_date();
-        if (streak_count > 0) {
-            streak_count--;
+    // The streak is always derived from the days where the goal was met, so
+    // meeting the goal and then drinking less again undoes itself
+    bool goal_met = is_goal_met();
+    if (goal_met != streaks_goal_met(today)) {
+        streaks_set_goal_met(today, goal_met);
+        if (goal_met) {
+            last_streak_date = get_todays_date();
         }
+        mark_state_dirty();
+    }
+    streak_count = streaks_current(today);
+}
+
+// Longest streak since the profile was last reset, including the current one
+static uint16_t get_longest_streak() {
+    uint32_t since = (drinking_since - end_of_day * SEC_IN_HOUR) / SEC_IN_DAY;
+    uint32_t today = day_clock_today();
+    uint16_t longest = streaks_longest(since, today + 1);
+    if (longest_streak > longest) longest = longest_streak;
+    if (streak_count > longest) longest = streak_count;
+    return longest;
+}
+
+// Carries over a streak from before goal days were recorded in the bitmap
+static void seed_streaks_if_needed() {
+    if (!streaks_is_empty()) {
+        return;
+    }
+    uint32_t last_day = last_streak_date / SEC_IN_DAY;
+    for (uint16_t i = 0; i < streak_count; i++) {
+        streaks_set_goal_met(last_day - i, true);
     }
-    
-    update_streak_display();
 }
 
 static void reset_profile() {
     total_consumed = current_oz;
     longest_streak = 0;
     drinking_since = now();
+    total_drinks = 0;
+    days_logged = 0;
+    mark_state_dirty();
     layer_mark_dirty(menu_layer_get_layer(profile_menu_layer));
 }
 
-static void cancel_app_exit_and_remove_notify_text() {
+// Writes a volume in gallons or liters, depending on the unit system
+static void format_volume(char *buffer, size_t size, uint32_t oz) {
+    if (unit_system == CUSTOMARY) {
+        if (oz == OZ_IN_GAL) {
+            snprintf(buffer, size, "1.0 Gallon");
+        } else {
+            snprintf(buffer, size, "%u.%01u Gallons", (int)(oz / OZ_IN_GAL), (int)(oz * 10 / OZ_IN_GAL % 10));
+        }
+    } else {
+        uint32_t ml = oz * EXACT_ML_IN_OZ;
+        if (ml == ML_IN_L) {
+            snprintf(buffer, size, "1.0 Liter");
+        } else {
+            snprintf(buffer, size, "%u.%01u Liters", (int)(ml / ML_IN_L), (int)(ml * 10 / ML_IN_L % 10));
+        }
+    }
+}
+
+static void remove_notify_text() {
     if (!layer_get_hidden(text_layer_get_layer(notify_text_layer))) {
-        app_timer_cancel(quit_timer);
         layer_set_hidden(text_layer_get_layer(notify_text_layer), true);
     }
 }
 
 static void select_click_handler(ClickRecognizerRef recognizer, void *context) {
-    cancel_app_exit_and_remove_notify_text();
+    flush_clicks();
+    remove_notify_text();
     settings_menu_show();
 }
 
 static void up_click_handler(ClickRecognizerRef recognizer, void *context) {
-    cancel_app_exit_and_remove_notify_text();
-    increment_volume();
+    remove_notify_text();
+    queue_volume_change(1);
 }
 
 static void down_click_handler(ClickRecognizerRef recognizer, void *context) {
-    cancel_app_exit_and_remove_notify_text();
-    decrement_volume();
+    remove_notify_text();
+    queue_volume_change(-1);
 }
 
 static void click_config_provider(void *context) {
@@ -613,20 +816,19 @@ static void CDU_select_click_handler(ClickRecognizerRef recognizer, void *contex
     unit = CUSTOM;
     cdu_oz = temp_cdu_oz;
     cdu_ml = temp_cdu_ml;
-    update_volume_display();
-    reset_reminder();
+    state_changed(DIRTY_UNIT);
     window_stack_pop(true);
     window_stack_pop(true);
 }
 
 static void CDU_up_click_handler(ClickRecognizerRef recognizer, void *context) {
     if (unit_system == CUSTOMARY) {
-        if (temp_cdu_oz < OZ_IN_GAL * get_goal_scale()) {
+        if (temp_cdu_oz < get_goal_vol(CUSTOMARY)) {
             temp_cdu_oz++;
             CDU_update_display();
         }
     } else if (unit_system == METRIC) {
-        if (temp_cdu_ml < ML_IN_GAL * get_goal_scale()) {
+        if (temp_cdu_ml < get_goal_vol(METRIC)) {
             temp_cdu_ml += 50;
             CDU_update_display();
         }
@@ -671,182 +873,166 @@ static void CDU_click_config_provider(void *context) {
 //     }
 // }
 
+// Wakeups that go off while the app is open. Launches by a wakeup are
+// handled in init().
 static void wakeup_handler(WakeupId id, int32_t reason) {
+    wakeup_planner_forget(id);
     if (reason == WAKEUP_REMINDER_REASON) {
-        persist_delete(WAKEUP_REMINDER_ID_KEY);
-        wakeup_reminder_id = 0;
         app_timer_cancel(remove_notify_timer);
         text_layer_set_text(notify_text_layer, "Drink water!");
         layer_set_hidden(text_layer_get_layer(notify_text_layer), false);
 
-        if (should_vibrate()) {
-            vibes_short_pulse();
-        }
-
-        if (launch_reason() == APP_LAUNCH_WAKEUP && !launched) {
-            launched = true;
-            app_timer_register(1000, reset_reminder, NULL);
-            // Auto exit the app after 2 minutes if it was awoken from a reminder
-            quit_timer = app_timer_register(120000, app_exit_callback, NULL);
-        } else {
-            reset_reminder();
-        }
+        alert_reminder();
+        schedule_reminder_if_run_out();
     } else if (reason == WAKEUP_RESET_REASON) {
-        persist_delete(WAKEUP_RESET_ID_KEY);
-        wakeup_reset_id = 0;
         text_layer_set_text(notify_text_layer, "New day!");
         layer_set_hidden(text_layer_get_layer(notify_text_layer), false);
-        if (launch_reason() == APP_LAUNCH_WAKEUP && !launched) {
-            launched = true;
-            app_timer_register(1000, reset_reminder, NULL);
-            //app_timer_register(1000, schedule_reset_if_needed, NULL);
-            // Auto exit the app after 2 minutes if it was awoken for a reset
-            quit_timer = app_timer_register(120000, app_exit_callback, NULL);
-        } else {
-            reset_reminder();
-            //schedule_reset_if_needed();
-            remove_notify_timer = app_timer_register(120000, cancel_app_exit_and_remove_notify_text, NULL);
-        }
+        reset_reminder();
+        remove_notify_timer = app_timer_register(120000, remove_notify_text, NULL);
         reset_current_date_and_volume_if_needed();
     }
 }
 
+// Brings both the reminder and the reset wakeups up to date, e.g. after a
+// settings change or a new day. Wakeups that are already at the right time
+// are left alone.
 static void reset_reminder() {
-    // Cancel the reminder timer if one is present
-    wakeup_cancel_all();
-    persist_delete(WAKEUP_REMINDER_ID_KEY);
-    persist_delete(WAKEUP_RESET_ID_KEY);
-    wakeup_reminder_id = 0;
-    wakeup_reset_id = 0;
-
-    // Restart the reminder timer if the goal isn't met
-    schedule_reminder_if_needed();
+    // The reset goes first so that it keeps its exact time and the reminder
+    // moves if they clash
     schedule_reset_if_needed();
+    schedule_reminder_if_needed();
 }
 
-static void schedule_reminder_if_needed() {
+// Works out the reminders for the rest of the day, writing up to max of them
+// to times
+static uint8_t get_reminder_times(time_t *times, uint8_t max) {
     // Reminders are off, don't schedule a reminder
     if (inactivity_reminder_hours == 0) {
-        return;
+        return 0;
     }
 
     // Goal is met, so don't schedule a reminder
-    if (calc_current_volume() == get_unit_in_gal(false) * get_goal_scale()) {
-        return;
+    if (is_goal_met()) {
+        return 0;
     }
 
-    bool wakeup_scheduled = false;
-
-    // Check if we have already scheduled a wakeup event
-    if (persist_exists(WAKEUP_REMINDER_ID_KEY)) {
-        wakeup_reminder_id = persist_read_int(WAKEUP_REMINDER_ID_KEY);
-        // query if event is still valid
-        if (wakeup_query(wakeup_reminder_id, NULL)) {
-            wakeup_scheduled = true;
-        } else {
-            persist_delete(WAKEUP_REMINDER_ID_KEY);
-            wakeup_reminder_id = 0;
+    time_t offset = day_clock_utc_offset();
+    ReminderDay day = {
+        .now = now() - offset,
+        .day_start = get_next_reset_time() - SEC_IN_DAY - offset,
+        .last = get_next_reset_time() - offset - SEC_IN_HOUR * 2,
+        .snoozed_until = snoozed_until,
+        .backoff = get_reminder_backoff(),
+    };
+
+    if (inactivity_reminder_hours == 1) {
+        // Auto reminders based on how many hours are left in the day and 
+        // how much you still need to drink, one for each unit left
+        refresh_derived();
+        float units_goal = derived.reminder_units_goal;
+        float units_left = units_goal - derived.reminder_units_done;
+        // Once there's enough history, follow when the user usually drinks,
+        // as long as that would still meet the goal
+        if (intake_profile_ready() &&
+                reminder_plan_on_pace(&day, derived.reminder_units_done, units_goal, derived.goal_ml)) {
+            return reminder_plan_paced(&day, derived.reminder_units_done, units_goal, times, max);
         }
+        uint8_t count = (units_left < max) ? (uint8_t)(units_left + 0.999) : max;
+        return reminder_plan_spaced(&day, hours_left_in_day() / units_left, count, times, max);
     }
 
-    // Check to see if we were launched by a wakeup event
-    if (launch_reason() == APP_LAUNCH_WAKEUP && !launched) {
-        WakeupId id = 0;
-        int32_t reason = 0;
-        if (wakeup_get_launch_event(&id, &reason)) {
-            wakeup_handler(id, reason);
-        }
-    } else if (!wakeup_scheduled) {
-        float hours = 0;
-        if (inactivity_reminder_hours == 1) {
-            // Auto reminders based on how many hours are left in the day and 
-            // how much you still need to drink
-            // APP_LOG(APP_LOG_LEVEL_DEBUG, "Unit in gal: %u", get_unit_in_gal(true));
-            // APP_LOG(APP_LOG_LEVEL_DEBUG, "Unit in gal: %u", get_unit_in_gal(true));
-            uint16_t current_volume_scalar = 1;
-            if (unit == CUSTOM) {
-                current_volume_scalar = (unit_system == CUSTOMARY) ? cdu_oz : cdu_ml;
-            }
-            hours = hours_left_in_day() / 
-                    (get_unit_in_gal(true) * get_goal_scale() - 
-                    calc_current_volume() / current_volume_scalar);
-            // APP_LOG(APP_LOG_LEVEL_DEBUG, "Reminder seconds: %d", (int)(hours*SEC_IN_HOUR));
-            // If using the metric unit system, scale the amount by drinking unit
-            if (unit_system == METRIC && unit != CUSTOM) {
-                hours *= get_ml_in(unit);
-            }
+    // Hour-based reminders
+    return reminder_plan_spaced(&day, inactivity_reminder_hours - 1, max, times, max);
+}
 
-            // APP_LOG(APP_LOG_LEVEL_DEBUG, "Reminder seconds: %d", (int)(hours*SEC_IN_HOUR));
-        } else {
-            // Hour-based reminders
-            hours = inactivity_reminder_hours - 1;
-        }
-        if (hours < 0.5) hours = 0.5;
-        time_t future_time = now() + hours * SEC_IN_HOUR - get_UTC_offset(NULL);
-        // Avoid time conflict with reset time
-        if (future_time == (get_next_reset_time() - get_UTC_offset(NULL))) future_time += 0.5 * SEC_IN_HOUR;
-
-        // Repeatedly try to schedule the wakeup in case of conflicting wakeup times
-        wakeup_reminder_id = 0;
-        uint8_t attempts = 0;
-        while ((!wakeup_reminder_id || wakeup_reminder_id == E_RANGE || wakeup_reminder_id == E_INTERNAL) && attempts < 100) {
-            // Add a minute to wakeup timer if the error was for time range
-            if (wakeup_reminder_id == E_RANGE) {
-                future_time = future_time + 60;
-            }
+// Every reminder in a row that goes by without a drink doubles the time to
+// the next one, up to 2^REMINDER_BACKOFF_MAX_SHIFT times
+static uint8_t get_reminder_backoff() {
+    return 1 << ((ignored_reminders < REMINDER_BACKOFF_MAX_SHIFT) ? ignored_reminders : REMINDER_BACKOFF_MAX_SHIFT);
+}
 
-            // Schedule wakeup event and keep the WakeupId in case it needs to be queried
-            wakeup_reminder_id = wakeup_schedule(future_time, WAKEUP_REMINDER_REASON, false);
-            // APP_LOG(APP_LOG_LEVEL_DEBUG, "Reminder time: %d", (int)future_time);
-            attempts++;
-        }
+static void alert_reminder() {
+    reminders_shown++;
+    if (should_vibrate()) {
+        vibes_short_pulse();
+        reminders_vibrated++;
+    }
+    mark_state_dirty();
+}
+
+// Only the reminders depend on the volume, so this is all a drink needs
+static void schedule_reminder_if_needed() {
+    time_t reminder_times[REMINDER_SLOTS];
+    uint8_t count = get_reminder_times(reminder_times, REMINDER_SLOTS);
+    wakeup_planner_sync(WAKEUP_REMINDER_REASON, reminder_times, count, REMINDER_TOLERANCE, false);
+}
 
-        // Persist to allow wakeup query after the app is closed.
-        persist_write_int(WAKEUP_REMINDER_ID_KEY, wakeup_reminder_id);
+// The rest of the day's reminders are planned already when one goes off.
+// Planning again from the new time would move all of them, so that only
+// happens once they have run out or the user answers the reminder.
+static void schedule_reminder_if_run_out() {
+    if (!wakeup_planner_find(WAKEUP_REMINDER_REASON, NULL)) {
+        schedule_reminder_if_needed();
     }
 }
 
+// The worker leaves the saved state alone while the app is open, so the app
+// keeps its own reset wakeup in case the day ends before it's closed.
+// cancel_reset_if_worker_running() hands the reset back to the worker.
 static void schedule_reset_if_needed() {
-    bool wakeup_scheduled = false;
+    time_t reset_time = get_next_reset_time() - day_clock_utc_offset();
+    wakeup_planner_sync(WAKEUP_RESET_REASON, &reset_time, 1, RESET_TOLERANCE, true);
+}
 
-    // Check if we have already scheduled a wakeup event
-    if (persist_exists(WAKEUP_RESET_ID_KEY)) {
-        wakeup_reset_id = persist_read_int(WAKEUP_RESET_ID_KEY);
-        // query if event is still valid
-        if (wakeup_query(wakeup_reset_id, NULL)) {
-            wakeup_scheduled = true;
-        } else {
-            persist_delete(WAKEUP_RESET_ID_KEY);
-            wakeup_reset_id = 0;
-        }
+// The worker starts new days by itself once the app is closed, so the reset
+// wakeup is only a fallback for when it isn't running
+static void cancel_reset_if_worker_running() {
+    if (app_worker_is_running()) {
+        wakeup_planner_sync(WAKEUP_RESET_REASON, NULL, 0, RESET_TOLERANCE, true);
     }
+}
 
-    // Check to see if we were launched by a wakeup event
-    if (launch_reason() == APP_LAUNCH_WAKEUP && !launched) {
-        WakeupId id = 0;
-        int32_t reason = 0;
-        if (wakeup_get_launch_event(&id, &reason)) {
-            wakeup_handler(id, reason);
-        }
-    } else if (!wakeup_scheduled) {
-        time_t future_time = get_next_reset_time() - get_UTC_offset(NULL);
-
-        // Repeatedly try to schedule the wakeup in case of conflicting wakeup times
-        wakeup_reset_id = 0;
-        uint8_t attempts = 0;
-        while ((!wakeup_reset_id || wakeup_reset_id == E_RANGE || wakeup_reset_id == E_INTERNAL) && attempts < 100) {
-            // Add a minute to wakeup timer if the error was for time range
-            if (wakeup_reset_id == E_RANGE) {
-                future_time = future_time + 60;
-            }
+static void launch_worker_on_first_run() {
+    if (persist_exists(WORKER_OFFERED_KEY)) {
+        return;
+    }
+    persist_write_bool(WORKER_OFFERED_KEY, true);
+    if (!app_worker_is_running()) {
+        app_worker_launch();
+    }
+}
 
-            // Schedule wakeup event and keep the WakeupId in case it needs to be queried
-            wakeup_reset_id = wakeup_schedule(future_time, WAKEUP_RESET_REASON, true);
-            attempts++;
-        }
+// The settings menu's Background Worker row
+static void toggle_worker() {
+    if (app_worker_is_running()) {
+        app_worker_kill();
+    } else {
+        app_worker_launch();
+    }
+    menu_layer_reload_data(settings_menu_layer);
+}
+
+// Tells the worker whether the app currently owns the saved state
+static void send_worker_message(WorkerMessage type) {
+    AppWorkerMessage message = { 0 };
+    app_worker_send_message(type, &message);
+}
 
-        // Persist to allow wakeup query after the app is closed.
-        persist_write_int(WAKEUP_RESET_ID_KEY, wakeup_reset_id);
+static void worker_message_handler(uint16_t type, AppWorkerMessage *data) {
+    if (type == WORKER_MSG_STARTED) {
+        send_worker_message(WORKER_MSG_APP_OPENED);
+    }
+}
+
+// Hands wakeups scheduled by versions without the planner over to it
+static void adopt_legacy_wakeups() {
+    if (persist_exists(WAKEUP_REMINDER_ID_KEY)) {
+        wakeup_planner_adopt(persist_read_int(WAKEUP_REMINDER_ID_KEY), WAKEUP_REMINDER_REASON);
+        persist_delete(WAKEUP_REMINDER_ID_KEY);
+    }
+    if (persist_exists(WAKEUP_RESET_ID_KEY)) {
+        wakeup_planner_adopt(persist_read_int(WAKEUP_RESET_ID_KEY), WAKEUP_RESET_REASON);
+        persist_delete(WAKEUP_RESET_ID_KEY);
     }
 }
 
@@ -855,41 +1041,97 @@ static void app_exit_callback() {
 }
 
 static void load_persistent_storage() {
-    current_oz = persist_exists(CURRENT_OZ_KEY) ? persist_read_int(CURRENT_OZ_KEY) : 0;
-    current_ml = persist_exists(CURRENT_ML_KEY) ? persist_read_int(CURRENT_ML_KEY) : 0;
-    start_of_day = persist_exists(SOD_KEY) ? persist_read_int(SOD_KEY) : 9;
-    end_of_day = persist_exists(EOD_KEY) ? persist_read_int(EOD_KEY) : 0;
-    inactivity_reminder_hours = persist_exists(REMINDER_KEY) ? persist_read_int(REMINDER_KEY) : 1;
-    unit_system = persist_exists(UNIT_SYSTEM_KEY) ? persist_read_int(UNIT_SYSTEM_KEY) : CUSTOMARY;
-    goal = persist_exists(GOAL_KEY) ? persist_read_int(GOAL_KEY) : GALLON;
-    unit = persist_exists(UNIT_KEY) ? persist_read_int(UNIT_KEY) : CUP;
-    streak_count = persist_exists(STREAK_COUNT_KEY) ? persist_read_int(STREAK_COUNT_KEY) : 0;
-    last_streak_date = persist_exists(LAST_STREAK_DATE_KEY) ? persist_read_int(LAST_STREAK_DATE_KEY) : get_yesterdays_date();
-    current_date = persist_exists(CURRENT_DATE_KEY) ? persist_read_int(CURRENT_DATE_KEY) : get_todays_date();
-    total_consumed = persist_exists(TOTAL_CONSUMED_KEY) ? persist_read_int(TOTAL_CONSUMED_KEY) : 0;
-    longest_streak = persist_exists(LONGEST_STREAK_KEY) ? persist_read_int(LONGEST_STREAK_KEY) : 0;
-    cdu_oz = persist_exists(CDU_OZ_KEY) ? persist_read_int(CDU_OZ_KEY) : 8;
-    cdu_ml = persist_exists(CDU_ML_KEY) ? persist_read_int(CDU_ML_KEY) : 250;
-    drinking_since = persist_exists(DRINKING_SINCE_KEY) ? persist_read_int(DRINKING_SINCE_KEY) : now();
+    PersistedState state;
+    state_store_load(&state, now());
+
+    unit_system = state.unit_system;
+    goal = state.goal;
+    unit = state.unit;
+    current_oz = state.current_oz;
+    start_of_day = state.start_of_day;
+    end_of_day = state.end_of_day;
+    inactivity_reminder_hours = state.inactivity_reminder_hours;
+    cdu_oz = state.cdu_oz;
+    current_ml = state.current_ml;
+    cdu_ml = state.cdu_ml;
+    streak_count = state.streak_count;
+    longest_streak = state.longest_streak;
+    total_consumed = (state.version >= 2) ? state.total_consumed : state.total_consumed_v1;
+    current_date = state.current_date;
+    last_streak_date = state.last_streak_date;
+    drinking_since = state.drinking_since;
+    total_drinks = state.total_drinks;
+    days_logged = state.days_logged;
+    ignored_reminders = state.ignored_reminders;
+    snoozed_until = state.snoozed_until;
+    reminders_shown = state.reminders_shown;
+    reminders_vibrated = state.reminders_vibrated;
+    reminders_answered = state.reminders_answered;
 }
 
 static void save_persistent_storage() {
-    persist_write_int(CURRENT_OZ_KEY, current_oz);
-    persist_write_int(CURRENT_ML_KEY, current_ml);
-    persist_write_int(SOD_KEY, start_of_day);
-    persist_write_int(EOD_KEY, end_of_day);
-    persist_write_int(REMINDER_KEY, inactivity_reminder_hours);
-    persist_write_int(UNIT_SYSTEM_KEY, unit_system);
-    persist_write_int(GOAL_KEY, goal);
-    persist_write_int(UNIT_KEY, unit);
-    persist_write_int(STREAK_COUNT_KEY, streak_count);
-    persist_write_int(LAST_STREAK_DATE_KEY, (int)last_streak_date);
-    persist_write_int(CURRENT_DATE_KEY, (int)current_date);
-    persist_write_int(TOTAL_CONSUMED_KEY, total_consumed);
-    persist_write_int(LONGEST_STREAK_KEY, longest_streak);
-    persist_write_int(CDU_OZ_KEY, cdu_oz);
-    persist_write_int(CDU_ML_KEY, cdu_ml);
-    persist_write_int(DRINKING_SINCE_KEY, (int)drinking_since);
+    PersistedState state = {
+        .version = STATE_VERSION,
+        .unit_system = unit_system,
+        .goal = goal,
+        .unit = unit,
+        .current_oz = current_oz,
+        .start_of_day = start_of_day,
+        .end_of_day = end_of_day,
+        .inactivity_reminder_hours = inactivity_reminder_hours,
+        .cdu_oz = cdu_oz,
+        .current_ml = current_ml,
+        .cdu_ml = cdu_ml,
+        .streak_count = streak_count,
+        .longest_streak = longest_streak,
+        .total_consumed_v1 = total_consumed,
+        .total_consumed = total_consumed,
+        .current_date = current_date,
+        .last_streak_date = last_streak_date,
+        .drinking_since = drinking_since,
+        .total_drinks = total_drinks,
+        .days_logged = days_logged,
+        .ignored_reminders = ignored_reminders,
+        .snoozed_until = snoozed_until,
+        .reminders_shown = reminders_shown,
+        .reminders_vibrated = reminders_vibrated,
+        .reminders_answered = reminders_answered,
+    };
+    state_store_save(&state);
+}
+
+// Schedules a write-back of the state instead of saving on every change, so a
+// held button only costs one flash write per SAVE_INTERVAL_MS
+static void mark_state_dirty() {
+    if (state_dirty) {
+        STATS_COUNT(persist_writes_avoided);
+        return;
+    }
+    state_dirty = true;
+    save_timer = app_timer_register(SAVE_INTERVAL_MS, save_timer_callback, NULL);
+}
+
+static void save_timer_callback() {
+    save_timer = NULL;
+    flush_persistent_storage();
+}
+
+static void flush_persistent_storage() {
+    if (save_timer) {
+        app_timer_cancel(save_timer);
+        save_timer = NULL;
+    }
+    if (!state_dirty) {
+        return;
+    }
+    save_persistent_storage();
+    history_flush();
+    streaks_flush();
+    intake_index_flush();
+    intake_pyramid_flush();
+    drink_log_flush();
+    intake_profile_flush();
+    state_dirty = false;
 }
 
 static void window_load(Window *window) {
@@ -906,17 +1148,14 @@ static void window_load(Window *window) {
         chalk_shift = 14;
     #endif
 
-    gallon_filled_layer = bitmap_layer_create(GRect(x_shift + chalk_shift, 29 + y_shift, 64, 92));
-    layer_add_child(window_layer, bitmap_layer_get_layer(gallon_filled_layer));
-    
-    white_layer = text_layer_create(GRect(x_shift, 29 + y_shift, 64, 92));
-    text_layer_set_background_color(white_layer, PBL_IF_COLOR_ELSE(GColorWhite, GColorWhite));
-    layer_add_child(window_layer, text_layer_get_layer(white_layer));
-    
-    gallon_layer = bitmap_layer_create(GRect(x_shift + chalk_shift, 29 + y_shift, 64, 92));
-    bitmap_layer_set_background_color(gallon_layer, GColorClear);
-    bitmap_layer_set_compositing_mode(gallon_layer, GCompOpClear);
-    layer_add_child(window_layer, bitmap_layer_get_layer(gallon_layer));
+    atlas_layer = layer_create(bounds);
+    layer_set_update_proc(atlas_layer, atlas_update_proc);
+    layer_add_child(window_layer, atlas_layer);
+    glyph_atlas_init(&counter_atlas, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD), COUNTER_GLYPHS);
+
+    container_layer = layer_create(GRect(x_shift + chalk_shift, 29 + y_shift, 64, 92));
+    layer_set_update_proc(container_layer, container_update_proc);
+    layer_add_child(window_layer, container_layer);
     
     streak_text_layer = text_layer_create(GRect(chalk_shift, y_shift, width, 60));
     text_layer_set_font(streak_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24));
@@ -924,11 +1163,10 @@ static void window_load(Window *window) {
     text_layer_set_background_color(streak_text_layer, PBL_IF_COLOR_ELSE(GColorClear, GColorClear));
     layer_add_child(window_layer, text_layer_get_layer(streak_text_layer));
     
-    text_layer = text_layer_create(GRect(chalk_shift, 116 + y_shift, width, 60));
-    text_layer_set_font(text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-    text_layer_set_text_alignment(text_layer, GTextAlignmentCenter);
-    text_layer_set_background_color(text_layer, PBL_IF_COLOR_ELSE(GColorClear, GColorClear));
-    layer_add_child(window_layer, text_layer_get_layer(text_layer));
+    volume_text[0] = '\0';
+    counter_layer = layer_create(GRect(chalk_shift, 116 + y_shift, width, 60));
+    layer_set_update_proc(counter_layer, counter_update_proc);
+    layer_add_child(window_layer, counter_layer);
 
     star_layer = bitmap_layer_create(GRect(width/2-13 + chalk_shift, 72 + y_shift, 26, 24));
     bitmap_layer_set_bitmap(star_layer, star);
@@ -953,12 +1191,13 @@ static void window_load(Window *window) {
 }
 
 static void window_unload(Window *window) {
-    text_layer_destroy(text_layer);
+    flush_clicks();
+    layer_destroy(counter_layer);
+    layer_destroy(atlas_layer);
+    glyph_atlas_deinit(&counter_atlas);
     text_layer_destroy(streak_text_layer);
-    text_layer_destroy(white_layer);
     text_layer_destroy(notify_text_layer);
-    bitmap_layer_destroy(gallon_layer);
-    bitmap_layer_destroy(gallon_filled_layer);
+    layer_destroy(container_layer);
     bitmap_layer_destroy(star_layer);
     action_bar_layer_destroy(action_bar);
 }
@@ -996,9 +1235,76 @@ static void CDU_window_unload(Window *window) {
 }
 
 static void init(void) {
+    // Keep the worker from rolling the day over while the app has the state
+    app_worker_message_subscribe(worker_message_handler);
+    send_worker_message(WORKER_MSG_APP_OPENED);
+
     load_persistent_storage();
+    day_clock_set_end_of_day(end_of_day);
+    history_init();
+    streaks_init();
+    seed_streaks_if_needed();
+    intake_index_init();
+    intake_pyramid_init();
+    drink_log_init();
+    intake_profile_init();
+    wakeup_planner_init();
+    wakeup_planner_set_quiet_hours(get_quiet_hours());
+    adopt_legacy_wakeups();
+
+    // Check to see if we were launched by a wakeup event
+    WakeupId id = 0;
+    int32_t reason = 0;
+    bool woken = launch_reason() == APP_LAUNCH_WAKEUP && wakeup_get_launch_event(&id, &reason);
+    if (woken && reason == WAKEUP_RESET_REASON) {
+        // There's nothing to show for a new day, so roll it over straight from
+        // the saved state and exit without loading any of the UI
+        headless = true;
+#ifdef GALLON_STATS
+        time_t start_s, end_s;
+        uint16_t start_ms = time_ms(&start_s, NULL);
+#endif
+        wakeup_planner_forget(id);
+        if (!roll_over_day_if_needed()) {
+            reset_reminder();
+        }
+        update_streak_count();
+#ifdef GALLON_STATS
+        uint16_t end_ms = time_ms(&end_s, NULL);
+        APP_LOG(APP_LOG_LEVEL_DEBUG, "Headless reset took %d ms", (int)((end_s - start_s) * 1000 + end_ms - start_ms));
+#endif
+        return;
+    }
     
+    launch_worker_on_first_run();
+
     action_icon_plus = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_ACTION_ICON_PLUS);
+    // The worker launches the app for the first reminder of the day
+    if ((woken && reason == WAKEUP_REMINDER_REASON) || launch_reason() == APP_LAUNCH_WORKER) {
+        // A reminder only needs a way to log a drink, the rest of the UI is
+        // loaded if the user asks for it
+        if (woken) {
+            wakeup_planner_forget(id);
+        }
+        roll_over_day_if_needed();
+        update_streak_count();
+        action_icon_snooze = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_ACTION_ICON_SNOOZE);
+        reminder_window_show();
+        alert_reminder();
+        // The next reminder is planned once this one is answered or ignored,
+        // see the reminder window's handlers
+        return;
+    }
+
+    main_window_show();
+    if (woken) {
+        wakeup_handler(id, reason);
+    } else {
+        reset_reminder();
+    }
+}
+
+static void main_window_show() {
     action_icon_settings = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_ACTION_ICON_SETTINGS);
     action_icon_minus = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_ACTION_ICON_MINUS);
     action_icon_check = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_ACTION_ICON_CHECK);
@@ -1014,14 +1320,32 @@ static void init(void) {
     window_stack_push(main_window, true);
     
     wakeup_service_subscribe(wakeup_handler);
-    schedule_reminder_if_needed();
-    schedule_reset_if_needed();
 }
 
 static void deinit(void) {
-    save_persistent_storage();
+    flush_persistent_storage();
+    history_deinit();
+    streaks_deinit();
+    intake_index_deinit();
+    intake_pyramid_deinit();
+    drink_log_deinit();
+    intake_profile_deinit();
+    cancel_reset_if_worker_running();
+    send_worker_message(WORKER_MSG_APP_CLOSED);
+#ifdef GALLON_STATS
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Persist writes avoided: %u", persist_writes_avoided);
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Container redraws: %u, redraws avoided: %u", container_redraws, redraws_avoided);
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Day clock refreshes: %u", day_clock_refreshes());
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Wakeups scheduled: %u in %u attempts", wakeup_planner_schedules(), wakeup_planner_attempts());
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Reminders: %u shown, %u vibrated, %u answered over %u days, %u ignored in a row",
+        reminders_shown, reminders_vibrated, reminders_answered, days_logged, ignored_reminders);
+#endif
+    if (headless) {
+        return;
+    }
     
     gbitmap_destroy(action_icon_plus);
+    gbitmap_destroy(action_icon_snooze);
     gbitmap_destroy(action_icon_settings);
     gbitmap_destroy(action_icon_minus);
     gbitmap_destroy(action_icon_check);
@@ -1029,16 +1353,117 @@ static void deinit(void) {
     gbitmap_destroy(gallon_image);
     gbitmap_destroy(star);
     
-    window_destroy(main_window);
+    if (main_window) {
+        window_destroy(main_window);
+    }
 }
 
 int main(void) {
     init();
-    app_event_loop();
+    if (!headless) {
+        app_event_loop();
+    }
     deinit();
 }
 
 
+// Reminder window stuff
+static void reminder_restart_idle_timer() {
+    app_timer_cancel(reminder_idle_timer);
+    reminder_idle_timer = app_timer_register(REMINDER_IDLE_MS, reminder_idle_callback, NULL);
+}
+
+static void reminder_idle_callback() {
+    reminder_idle_timer = NULL;
+    app_exit_callback();
+}
+
+// Up logs a drink and exits straight away, deinit() saves it
+static void reminder_up_click_handler(ClickRecognizerRef recognizer, void *context) {
+    reminder_handled = true;
+    reminders_answered++;
+    add_one_unit();
+    schedule_reminder_if_needed();
+    window_stack_pop_all(false);
+}
+
+// Select opens the full app in place of the reminder
+static void reminder_select_click_handler(ClickRecognizerRef recognizer, void *context) {
+    reminder_handled = true;
+    app_timer_cancel(reminder_idle_timer);
+    reminder_idle_timer = NULL;
+    schedule_reminder_if_needed();
+    main_window_show();
+    window_stack_remove(reminder_window, false);
+}
+
+// Down brings the reminder back in REMINDER_SNOOZE without counting it as
+// ignored
+static void reminder_down_click_handler(ClickRecognizerRef recognizer, void *context) {
+    reminder_handled = true;
+    snoozed_until = now() - day_clock_utc_offset() + REMINDER_SNOOZE;
+    mark_state_dirty();
+    schedule_reminder_if_needed();
+    window_stack_pop_all(false);
+}
+
+static void reminder_click_config_provider(void *context) {
+    window_single_click_subscribe(BUTTON_ID_UP, reminder_up_click_handler);
+    window_single_click_subscribe(BUTTON_ID_SELECT, reminder_select_click_handler);
+    window_single_click_subscribe(BUTTON_ID_DOWN, reminder_down_click_handler);
+}
+
+static void reminder_window_show() {
+    reminder_window = window_create();
+    window_set_window_handlers(reminder_window, (WindowHandlers) {
+        .load = reminder_window_load,
+        .unload = reminder_window_unload,
+    });
+    window_stack_push(reminder_window, true);
+}
+
+static void reminder_window_load(Window *window) {
+    static char reminder_text[40];
+    Layer *window_layer = window_get_root_layer(window);
+    GRect bounds = layer_get_bounds(window_layer);
+    uint8_t text_width = bounds.size.w - ACTION_BAR_WIDTH;
+
+    snprintf(reminder_text, sizeof(reminder_text), "Drink water!\n%s", get_volume_text());
+
+    reminder_text_layer = text_layer_create(GRect(PBL_IF_ROUND_ELSE(ACTION_BAR_WIDTH / 2, 0), bounds.size.h / 2 - 34, text_width, 68));
+    text_layer_set_font(reminder_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
+    text_layer_set_text_alignment(reminder_text_layer, GTextAlignmentCenter);
+    text_layer_set_text(reminder_text_layer, reminder_text);
+    layer_add_child(window_layer, text_layer_get_layer(reminder_text_layer));
+
+    reminder_action_bar = action_bar_layer_create();
+    action_bar_layer_add_to_window(reminder_action_bar, window);
+    action_bar_layer_set_click_config_provider(reminder_action_bar, reminder_click_config_provider);
+    action_bar_layer_set_icon(reminder_action_bar, BUTTON_ID_UP, action_icon_plus);
+    action_bar_layer_set_icon(reminder_action_bar, BUTTON_ID_DOWN, action_icon_snooze);
+
+    reminder_restart_idle_timer();
+}
+
+// Leaving with Back or by timing out ignores the reminder, which backs off
+// the ones after it
+static void reminder_window_unload(Window *window) {
+    if (!reminder_handled) {
+        if (ignored_reminders < UINT8_MAX) ignored_reminders++;
+        mark_state_dirty();
+        schedule_reminder_if_needed();
+    }
+    app_timer_cancel(reminder_idle_timer);
+    reminder_idle_timer = NULL;
+    text_layer_destroy(reminder_text_layer);
+    action_bar_layer_destroy(reminder_action_bar);
+    window_destroy(reminder_window);
+    reminder_window = NULL;
+}
+// End reminder window stuff
+
+
+
 // Settings menu stuff
 static void settings_menu_draw_header_callback(GContext* ctx, const Layer *cell_layer, uint16_t section_index, void *data) {
     switch (section_index) {
@@ -1058,10 +1483,10 @@ static uint16_t settings_menu_get_num_sections_callback(MenuLayer *menu_layer, v
 static uint16_t settings_menu_get_num_rows_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
     switch (section_index) {
         case 0:
-            return 1;
+            return 2;
             
         case 1:
-            return 6;
+            return 7;
             
         default:
             return 0;
@@ -1082,6 +1507,9 @@ static void settings_menu_draw_row_callback(GContext* ctx, const Layer *cell_lay
                 case 0:
                     menu_cell_basic_draw(ctx, cell_layer, "View Profile", NULL, NULL);
                     break;
+                case 1:
+                    menu_cell_basic_draw(ctx, cell_layer, "View History", NULL, NULL);
+                    break;
             }
             break;
             
@@ -1105,6 +1533,9 @@ static void settings_menu_draw_row_callback(GContext* ctx, const Layer *cell_lay
                 case 5:
                     menu_cell_basic_draw(ctx, cell_layer, "Drink Reminders", reminder_to_string(inactivity_reminder_hours), NULL);
                     break;
+                case 6:
+                    menu_cell_basic_draw(ctx, cell_layer, "Background Worker", app_worker_is_running() ? "On" : "Off", NULL);
+                    break;
             }
             break;
     }
@@ -1117,6 +1548,9 @@ static void settings_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell
                 case 0:
                     profile_menu_show();
                     break;
+                case 1:
+                    chart_show();
+                    break;
             }
             break;
         case 1:
@@ -1139,6 +1573,9 @@ static void settings_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell
                 case 5:
                     reminder_menu_show();
                     break;
+                case 6:
+                    toggle_worker();
+                    break;
             }
             break;
     }
@@ -1204,7 +1641,7 @@ static uint16_t profile_menu_get_num_sections_callback(MenuLayer *menu_layer, vo
 static uint16_t profile_menu_get_num_rows_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
     switch (section_index) {
         case 0:
-            return 3;
+            return 10;
             
         case 1:
             return 1;
@@ -1221,30 +1658,20 @@ static int16_t profile_menu_get_header_height_callback(MenuLayer *menu_layer, ui
 static void profile_menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuIndex *cell_index, void *data) {
     char buffer[20];
     uint16_t streak;
+    uint32_t today, end_day;
+    CivilDate since;
+    struct tm since_tm;
     // Determine which section we're going to draw in
     switch (cell_index->section) {
         case 0:
             // Use the row to specify which item we'll draw
             switch (cell_index->row) {
                 case 0:
-                    if (unit_system == CUSTOMARY) {
-                        if (total_consumed == OZ_IN_GAL) {
-                            snprintf(buffer, sizeof(buffer), "1.0 Gallon");
-                        } else {
-                            snprintf(buffer, sizeof(buffer), "%u.%01u Gallons", (int)(double)total_consumed/OZ_IN_GAL, (int)((double)total_consumed/OZ_IN_GAL*10)%10);
-                        }
-                    } else {
-                        int total_consumed_ml = total_consumed*EXACT_ML_IN_OZ;
-                        if (total_consumed_ml == ML_IN_L) {
-                            snprintf(buffer, sizeof(buffer), "1.0 Liter");
-                        } else {
-                            snprintf(buffer, sizeof(buffer), "%u.%01u Liters", (int)(double)total_consumed_ml/ML_IN_L, (int)((double)total_consumed_ml/ML_IN_L*10)%10);
-                        }
-                    }
+                    format_volume(buffer, sizeof(buffer), total_consumed);
                     menu_cell_basic_draw(ctx, cell_layer, "Total Consumed", buffer, NULL);
                     break;
                 case 1:
-                    streak = (streak_count > longest_streak) ? streak_count : longest_streak;
+                    streak = get_longest_streak();
                     if (streak == 1) {
                         snprintf(buffer, sizeof(buffer), "1 Day");
                     } else {
@@ -1253,9 +1680,48 @@ static void profile_menu_draw_row_callback(GContext* ctx, const Layer *cell_laye
                     menu_cell_basic_draw(ctx, cell_layer, "Longest Streak", buffer, NULL);
                     break;
                 case 2:
-                    strftime(buffer, 20, "%b %e, %Y", localtime(&drinking_since));
+                    // drinking_since is already local, so it mustn't go through localtime()
+                    since = civil_from_days(drinking_since / SEC_IN_DAY);
+                    since_tm = (struct tm) { .tm_year = since.year - 1900, .tm_mon = since.month - 1, .tm_mday = since.day };
+                    strftime(buffer, 20, "%b %e, %Y", &since_tm);
                     menu_cell_basic_draw(ctx, cell_layer, "Drinking Since", buffer, NULL);
                     break;
+                case 3:
+                    // Today only counts once its goal is met, so the rate
+                    // doesn't drop every morning
+                    today = day_clock_today();
+                    end_day = streaks_goal_met(today) ? today + 1 : today;
+                    snprintf(buffer, sizeof(buffer), "%u%% over 30 days",
+                        streaks_goals_met(end_day - 30, end_day) * 100 / 30);
+                    menu_cell_basic_draw(ctx, cell_layer, "Goal Completion", buffer, NULL);
+                    break;
+                case 4:
+                    format_volume(buffer, sizeof(buffer), last_7_days_oz);
+                    menu_cell_basic_draw(ctx, cell_layer, "Last 7 Days", buffer, NULL);
+                    break;
+                case 5:
+                    format_volume(buffer, sizeof(buffer), last_30_days_oz);
+                    menu_cell_basic_draw(ctx, cell_layer, "Last 30 Days", buffer, NULL);
+                    break;
+                case 6:
+                    format_volume(buffer, sizeof(buffer), last_365_days_oz);
+                    menu_cell_basic_draw(ctx, cell_layer, "Last 365 Days", buffer, NULL);
+                    break;
+                case 7:
+                    format_volume(buffer, sizeof(buffer), best_week_oz);
+                    menu_cell_basic_draw(ctx, cell_layer, "Best Week", has_full_week ? buffer : "Not enough days", NULL);
+                    break;
+                case 8:
+                    format_volume(buffer, sizeof(buffer), worst_week_oz);
+                    menu_cell_basic_draw(ctx, cell_layer, "Worst Week", has_full_week ? buffer : "Not enough days", NULL);
+                    break;
+                case 9:
+                    if (days_logged > 0) {
+                        uint32_t tenths = total_drinks * 10 / days_logged;
+                        snprintf(buffer, sizeof(buffer), "%u.%u on average", (unsigned)(tenths / 10), (unsigned)(tenths % 10));
+                    }
+                    menu_cell_basic_draw(ctx, cell_layer, "Drinks a Day", (days_logged > 0) ? buffer : "Not enough days", NULL);
+                    break;
             }
             break;
             
@@ -1281,6 +1747,18 @@ static void profile_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_
     }
 }
 
+// Range totals are read from the intake index once when the profile is
+// opened instead of on every draw
+static void profile_menu_update_stats() {
+    uint32_t today = day_clock_today();
+    uint16_t today_oz = get_current_oz();
+    last_7_days_oz = intake_index_sum(today - 6, today) + today_oz;
+    last_30_days_oz = intake_index_sum(today - 29, today) + today_oz;
+    last_365_days_oz = intake_index_sum(today - 364, today) + today_oz;
+    // Only finished weeks of the last year count
+    has_full_week = intake_index_week_extremes(today - 364, today, &best_week_oz, &worst_week_oz);
+}
+
 static void profile_menu_show() {
     profile_menu_window = window_create();
     window_set_window_handlers(profile_menu_window, (WindowHandlers) {
@@ -1294,6 +1772,8 @@ static void profile_menu_window_load(Window *window) {
     Layer *menu_window_layer = window_get_root_layer(window);
     GRect menu_bounds = layer_get_bounds(menu_window_layer);
     
+    profile_menu_update_stats();
+    
     // Create the menu layer
     profile_menu_layer = menu_layer_create(menu_bounds);
     
@@ -1318,7 +1798,131 @@ static void profile_menu_window_unload(Window *window) {
     menu_layer_destroy(profile_menu_layer);
     window_destroy(profile_menu_window);
 }
-// End settings menu stuff
+// End profile menu stuff
+
+
+
+// Chart stuff
+static const char* chart_level_to_string(PyramidLevel level) {
+    switch (level) {
+        case PYRAMID_WEEK:  return "Daily Average by Week";
+        case PYRAMID_MONTH: return "Daily Average by Month";
+        case PYRAMID_YEAR:  return "Daily Average by Year";
+        default:            return "";
+    }
+}
+
+static uint8_t chart_columns() {
+    GRect bounds = layer_get_bounds(chart_layer);
+    return (bounds.size.w - 2 * CHART_MARGIN) / CHART_BAR_WIDTH;
+}
+
+// Height in pixels of a daily intake in oz, a full gallon filling the chart
+static int16_t chart_bar_height(uint16_t oz, int16_t chart_height) {
+    if (oz > OZ_IN_GAL) oz = OZ_IN_GAL;
+    return oz * chart_height / OZ_IN_GAL;
+}
+
+// Draws one bar per pyramid bucket, newest on the right. Each bar is the
+// average day in its bucket, with ticks for the lowest and highest day.
+static void chart_layer_update_proc(Layer *layer, GContext *ctx) {
+    GRect bounds = layer_get_bounds(layer);
+    int16_t bottom = bounds.size.h - CHART_MARGIN;
+    int16_t chart_height = bottom - CHART_TOP;
+    int16_t right = bounds.size.w - CHART_MARGIN;
+    
+    graphics_context_set_text_color(ctx, GColorBlack);
+    graphics_draw_text(ctx, chart_level_to_string(chart_level), fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
+        GRect(CHART_MARGIN, PBL_IF_ROUND_ELSE(12, 0), bounds.size.w - 2 * CHART_MARGIN, CHART_TOP),
+        GTextOverflowModeTrailingEllipsis, GTextAlignmentCenter, NULL);
+    
+    // Goal line
+    int16_t goal_y = bottom - chart_bar_height(get_goal_vol(CUSTOMARY), chart_height);
+    graphics_context_set_stroke_color(ctx, GColorBlack);
+    graphics_draw_line(ctx, GPoint(CHART_MARGIN, goal_y), GPoint(right, goal_y));
+    graphics_draw_line(ctx, GPoint(CHART_MARGIN, bottom), GPoint(right, bottom));
+    
+    uint32_t newest = intake_pyramid_bucket_of(chart_level, day_clock_today()) - chart_offset;
+    uint8_t columns = chart_columns();
+    for (uint8_t column = 0; column < columns && column <= newest; column++) {
+        PyramidBucket bucket;
+        if (!intake_pyramid_read(chart_level, newest - column, &bucket)) {
+            continue;
+        }
+        
+        int16_t x = right - (column + 1) * CHART_BAR_WIDTH + 1;
+        int16_t bar_width = CHART_BAR_WIDTH - 2;
+        int16_t average = chart_bar_height(bucket.sum / bucket.days, chart_height);
+        int16_t min_y = bottom - chart_bar_height(bucket.min, chart_height);
+        int16_t max_y = bottom - chart_bar_height(bucket.max, chart_height);
+        
+        graphics_context_set_fill_color(ctx, PBL_IF_COLOR_ELSE(GColorVividCerulean, GColorBlack));
+        graphics_fill_rect(ctx, GRect(x, bottom - average, bar_width, average), 0, GCornerNone);
+        
+        graphics_context_set_stroke_color(ctx, GColorBlack);
+        graphics_draw_line(ctx, GPoint(x, max_y), GPoint(x + bar_width - 1, max_y));
+        graphics_context_set_stroke_color(ctx, GColorWhite);
+        graphics_draw_line(ctx, GPoint(x, min_y), GPoint(x + bar_width - 1, min_y));
+    }
+}
+
+// Select changes the zoom level
+static void chart_select_click_handler(ClickRecognizerRef recognizer, void *context) {
+    chart_level = (chart_level + 1) % PYRAMID_LEVELS;
+    chart_offset = 0;
+    layer_mark_dirty(chart_layer);
+}
+
+// Up scrolls back in time by half a screen
+static void chart_up_click_handler(ClickRecognizerRef recognizer, void *context) {
+    uint8_t columns = chart_columns();
+    uint16_t max_offset = (intake_pyramid_capacity(chart_level) > columns) ? intake_pyramid_capacity(chart_level) - columns : 0;
+    if (chart_offset < max_offset) {
+        chart_offset += columns / 2;
+        if (chart_offset > max_offset) chart_offset = max_offset;
+        layer_mark_dirty(chart_layer);
+    }
+}
+
+static void chart_down_click_handler(ClickRecognizerRef recognizer, void *context) {
+    if (chart_offset > 0) {
+        uint8_t step = chart_columns() / 2;
+        chart_offset = (chart_offset > step) ? chart_offset - step : 0;
+        layer_mark_dirty(chart_layer);
+    }
+}
+
+static void chart_click_config_provider(void *context) {
+    window_single_click_subscribe(BUTTON_ID_SELECT, chart_select_click_handler);
+    window_single_repeating_click_subscribe(BUTTON_ID_UP, 200, chart_up_click_handler);
+    window_single_repeating_click_subscribe(BUTTON_ID_DOWN, 200, chart_down_click_handler);
+}
+
+static void chart_show() {
+    chart_window = window_create();
+    window_set_click_config_provider(chart_window, chart_click_config_provider);
+    window_set_window_handlers(chart_window, (WindowHandlers) {
+        .load = chart_window_load,
+        .unload = chart_window_unload,
+    });
+    window_stack_push(chart_window, true);
+}
+
+static void chart_window_load(Window *window) {
+    Layer *window_layer = window_get_root_layer(window);
+    
+    chart_level = PYRAMID_WEEK;
+    chart_offset = 0;
+    chart_layer = layer_create(layer_get_bounds(window_layer));
+    layer_set_update_proc(chart_layer, chart_layer_update_proc);
+    layer_add_child(window_layer, chart_layer);
+}
+
+static void chart_window_unload(Window *window) {
+    layer_destroy(chart_layer);
+    window_destroy(chart_window);
+}
+// End chart stuff
 
 
 
@@ -1344,10 +1948,10 @@ static void unit_system_menu_draw_row_callback(GContext* ctx, const Layer *cell_
 }
 
 static void unit_system_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
-    unit_system = cell_index->row;
-    update_streak_count();
-    update_volume_display();
-    reset_reminder();
+    if (unit_system != cell_index->row) {
+        unit_system = cell_index->row;
+        state_changed(DIRTY_UNIT_SYSTEM);
+    }
     window_stack_pop(true);
 }
 
@@ -1419,17 +2023,18 @@ static void goal_menu_draw_row_callback(GContext* ctx, const Layer *cell_layer,
 }
 
 static void goal_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
-    goal = cell_index->row + 4;
-    if (cdu_oz > OZ_IN_GAL * get_goal_scale()) {
-        cdu_oz = OZ_IN_GAL * get_goal_scale();
-    }
-    if (cdu_ml > ML_IN_GAL * get_goal_scale()) {
-        cdu_ml = ML_IN_GAL * get_goal_scale();
+    if (goal != cell_index->row + 4) {
+        goal = cell_index->row + 4;
+        mark_derived_dirty(DIRTY_GOAL);
+        // The custom unit can't be more than the goal
+        if (cdu_oz > get_goal_vol(CUSTOMARY)) {
+            cdu_oz = get_goal_vol(CUSTOMARY);
+        }
+        if (cdu_ml > get_goal_vol(METRIC)) {
+            cdu_ml = get_goal_vol(METRIC);
+        }
+        state_changed(DIRTY_GOAL | DIRTY_UNIT);
     }
-    set_image_for_goal();
-    update_streak_count();
-    update_volume_display();
-    reset_reminder();
     window_stack_pop(true);
 }
 
@@ -1506,9 +2111,10 @@ static void unit_menu_draw_row_callback(GContext* ctx, const Layer *cell_layer,
 
 static void unit_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
     if (cell_index->row != 4) {
-        unit = cell_index->row;
-        update_volume_display();
-        reset_reminder();
+        if (unit != cell_index->row) {
+            unit = cell_index->row;
+            state_changed(DIRTY_UNIT);
+        }
         window_stack_pop(true);
     } else {
         custom_drink_unit_window = window_create();
@@ -1591,6 +2197,8 @@ static void sod_menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, M
 
 static void sod_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
     start_of_day = cell_index->row;
+    wakeup_planner_set_quiet_hours(get_quiet_hours());
+    mark_state_dirty();
     reset_reminder();
     window_stack_pop(true);
 }
@@ -1665,11 +2273,13 @@ static void eod_menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, M
 static void eod_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
     uint8_t old_end_of_day = end_of_day;
     end_of_day = cell_index->row;
+    day_clock_set_end_of_day(end_of_day);
+    wakeup_planner_set_quiet_hours(get_quiet_hours());
     uint32_t time_diff = (end_of_day - old_end_of_day) * SEC_IN_HOUR;
     current_date -= time_diff;
     last_streak_date -= time_diff;
-    reset_current_date_and_volume_if_needed();
-    reset_reminder();
+    roll_over_day_if_needed();
+    state_changed(DIRTY_DAY);
     window_stack_pop(true);
 }
 
@@ -1740,6 +2350,7 @@ static void reminder_menu_draw_row_callback(GContext* ctx, const Layer *cell_lay
 
 static void reminder_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
     inactivity_reminder_hours = cell_index->row;
+    mark_state_dirty();
 
     reset_reminder();
 
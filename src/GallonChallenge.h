@@ -1,76 +1,67 @@
 #ifndef GALLON_CHALLENGE_HEADER
 #define GALLON_CHALLENGE_HEADER
 
-// Key for saving the previous date that the user completed the day's challenge
-// to determine if the streak count needs to be reset. Saved as a time_t.
-#define LAST_STREAK_DATE_KEY 1000
-// Key for saving streak count
-#define STREAK_COUNT_KEY 1001
-// Keys for saving current day's water volume intake
-#define CURRENT_DATE_KEY 1002
-#define CURRENT_OZ_KEY 1003
-#define CURRENT_ML_KEY 1013
-// Key for saving display unit type
-#define UNIT_KEY 1004
-// Key for saving the type of unit system
-#define UNIT_SYSTEM_KEY 1011
-// Keys for saving the custom drinking unit in oz/ml
-#define CDU_OZ_KEY 1014
-#define CDU_ML_KEY 1015
-// Key for saving goal unit type
-#define GOAL_KEY 1005
-// Key for saving end of day
-#define EOD_KEY 1006
-// Key for saving start of day
-#define SOD_KEY 1012
-// Keys for saving profile info
-#define TOTAL_CONSUMED_KEY 1007
-#define LONGEST_STREAK_KEY 1008
-#define DRINKING_SINCE_KEY 1009
-// Key for saving the number of hours for inactivity reminder
-#define REMINDER_KEY 1010
+// Delay before dirty state is written back to persistent storage
+#define SAVE_INTERVAL_MS 5000
+
+// Define GALLON_STATS to count redraws and avoided writes, log the counters
+// from deinit() and time the headless reset. Release builds leave it out.
+// #define GALLON_STATS
+#ifdef GALLON_STATS
+#define STATS_COUNT(counter) ((counter)++)
+#else
+#define STATS_COUNT(counter)
+#endif
+
+// Inputs of the derived values, marked as changed with mark_derived_dirty().
+// The day only decides the streak and the wakeups, see state_changed().
+#define DIRTY_VOLUME      (1 << 0)
+#define DIRTY_GOAL        (1 << 1)
+#define DIRTY_UNIT        (1 << 2)
+#define DIRTY_UNIT_SYSTEM (1 << 3)
+#define DIRTY_DAY         (1 << 4)
+#define DIRTY_ALL         0x1f
+
+// Keys from 3000 on are owned by the paged stores, see History.h, Streaks.h,
+// IntakeIndex.h, IntakePyramid.h and DrinkLog.h
 
 #define WAKEUP_REMINDER_REASON 2000
-#define WAKEUP_REMINDER_ID_KEY 2001
 #define WAKEUP_RESET_REASON 2002
+// How far a wakeup that is already scheduled may be from where it should be
+// before it's moved
+#define REMINDER_TOLERANCE (10 * 60)
+#define RESET_TOLERANCE (5 * 60)
+// Reminders kept scheduled at once. Later ones would only be moved again by
+// the next drink or backoff, see test/test_reminder_plan.c
+#define REMINDER_SLOTS 1
+// Ignored reminders back off up to 2^REMINDER_BACKOFF_MAX_SHIFT times their
+// usual interval, see get_reminder_backoff()
+#define REMINDER_BACKOFF_MAX_SHIFT 3
+#define REMINDER_SNOOZE (10 * 60)
+// Clicks are applied at most once per display frame, and the updates that
+// follow a change in volume wait until the clicks have stopped
+#define CLICK_FRAME_MS 33
+#define CLICK_BURST_MS 666
+// A reminder launch exits after this long without a button press
+#define REMINDER_IDLE_MS 15000
+// Wakeup ids saved by older versions, now kept by the planner in
+// WAKEUP_PLAN_KEY, see WakeupPlanner.h
+#define WAKEUP_REMINDER_ID_KEY 2001
 #define WAKEUP_RESET_ID_KEY 2003
+// Set once the worker has been offered on the first run. Launching it can ask
+// the user to switch from another app's worker, so after that it's only
+// started or stopped from the settings menu.
+#define WORKER_OFFERED_KEY 2005
 
-#define OZ_IN_CUP 8
-#define OZ_IN_PINT 16
-#define OZ_IN_QUART 32
-#define OZ_IN_GAL 128
-#define EXACT_ML_IN_OZ 29.5735
-#define ML_IN_OZ 50 // approx
-#define ML_IN_CUP 250 // approx
-#define ML_IN_PINT 500 // approx
-#define ML_IN_QUART 1000 // approx
-#define ML_IN_GAL 4000 // approx
-#define CUP_IN_GAL 16
-#define PINT_IN_GAL 8
-#define QUART_IN_GAL 4
-#define ML_IN_L 1000
-
-#define SEC_IN_HOUR 3600
-#define SEC_IN_DAY 86400
-
-typedef enum {
-    OUNCE,
-    CUP,
-    PINT,
-    QUART,
-    HALF_GALLON,
-    GALLON,
-    CUSTOM
-} Unit;
-
-typedef enum {
-    CUSTOMARY,
-    METRIC
-} UnitSystem;
-
-static uint8_t half_gallon_height(float v);
-static uint8_t gallon_height(float v);
-static uint8_t container_height(float vol);
+// Characters the volume counter always needs, the unit's are added as needed
+#define COUNTER_GLYPHS "0123456789/ "
+
+// Layout of the history chart, in pixels
+#define CHART_MARGIN PBL_IF_ROUND_ELSE(24, 4)
+#define CHART_TOP PBL_IF_ROUND_ELSE(40, 26)
+#define CHART_BAR_WIDTH 8
+
+static uint8_t container_height(uint16_t vol);
 static const char* unit_system_to_string(UnitSystem us);
 static const char* unit_to_string(Unit u);
 static const char* custom_unit_to_string();
@@ -78,27 +69,50 @@ static const char* hour_to_string(uint8_t hour);
 static const char* reminder_to_string(uint8_t hour);
 static bool are_dates_equal(time_t date1, time_t date2);
 static bool should_vibrate();
-static time_t get_UTC_offset(struct tm *t);
+static uint32_t get_quiet_hours();
 static time_t now();
 static time_t get_todays_date();
-static time_t get_yesterdays_date();
 static time_t get_next_reset_time();
 static float hours_left_in_day();
 static bool reset_current_date_and_volume_if_needed();
+static bool roll_over_day_if_needed();
+static void record_finished_day();
+static void log_drink(uint16_t before_ml);
+static uint16_t get_current_oz();
 static uint16_t calc_current_volume();
 static uint16_t get_unit_in_gal(bool forAutoReminder);
 static uint16_t get_ml_in(Unit u);
 static float get_goal_scale();
 static uint16_t get_goal_vol(UnitSystem us);
+static void mark_derived_dirty(uint8_t inputs);
+static void refresh_derived();
+static void state_changed(uint8_t inputs);
 static void set_image_for_goal();
+static void draw_bitmap_rows(GContext *ctx, GBitmap *bitmap, int16_t top, int16_t bottom);
+static int16_t get_water_top();
+static void container_update_proc(Layer *layer, GContext *ctx);
+static const char* get_volume_text();
+static bool is_goal_met();
 static void update_volume_display();
+static void atlas_update_proc(Layer *layer, GContext *ctx);
+static void counter_update_proc(Layer *layer, GContext *ctx);
 static void update_streak_display();
-static void increment_volume();
-static void decrement_volume();
+static void queue_volume_change(int8_t units);
+static void apply_pending_units();
+static void finish_click_burst();
+static void flush_clicks();
+static void add_one_unit();
+static void get_unit_volume(uint16_t *oz, uint16_t *ml);
+static void clamp_volume_to_goal();
+static void add_unit_volume();
+static void remove_unit_volume();
 static void update_streak_count();
+static uint16_t get_longest_streak();
+static void seed_streaks_if_needed();
 static void reset_profile();
+static void format_volume(char *buffer, size_t size, uint32_t oz);
 
-static void cancel_app_exit_and_remove_notify_text();
+static void remove_notify_text();
 static void select_click_handler(ClickRecognizerRef recognizer, void *context);
 static void up_click_handler(ClickRecognizerRef recognizer, void *context);
 static void down_click_handler(ClickRecognizerRef recognizer, void *context);
@@ -113,12 +127,25 @@ static void CDU_click_config_provider(void *context);
 // static void handle_hour_tick(struct tm *tick_time, TimeUnits units_changed);
 static void wakeup_handler(WakeupId id, int32_t reason);
 static void reset_reminder();
+static uint8_t get_reminder_times(time_t *times, uint8_t max);
+static uint8_t get_reminder_backoff();
+static void alert_reminder();
 static void schedule_reminder_if_needed();
+static void schedule_reminder_if_run_out();
 static void schedule_reset_if_needed();
+static void cancel_reset_if_worker_running();
+static void launch_worker_on_first_run();
+static void toggle_worker();
+static void send_worker_message(WorkerMessage type);
+static void worker_message_handler(uint16_t type, AppWorkerMessage *data);
+static void adopt_legacy_wakeups();
 static void app_exit_callback();
 
 static void load_persistent_storage();
 static void save_persistent_storage();
+static void mark_state_dirty();
+static void save_timer_callback();
+static void flush_persistent_storage();
 
 static void window_load(Window *window);
 static void window_unload(Window *window);
@@ -127,8 +154,25 @@ static void CDU_window_load(Window *window);
 static void CDU_window_unload(Window *window);
 
 static void init(void);
+static void main_window_show();
 static void deinit(void);
 
+static Window *reminder_window;
+static TextLayer *reminder_text_layer;
+static ActionBarLayer *reminder_action_bar;
+static AppTimer *reminder_idle_timer;
+// Set once a button has decided what happens to the reminder
+static bool reminder_handled;
+static void reminder_restart_idle_timer();
+static void reminder_idle_callback();
+static void reminder_up_click_handler(ClickRecognizerRef recognizer, void *context);
+static void reminder_select_click_handler(ClickRecognizerRef recognizer, void *context);
+static void reminder_down_click_handler(ClickRecognizerRef recognizer, void *context);
+static void reminder_click_config_provider(void *context);
+static void reminder_window_show();
+static void reminder_window_load(Window *window);
+static void reminder_window_unload(Window *window);
+
 static Window *settings_menu_window;
 static MenuLayer *settings_menu_layer;
 static void settings_menu_draw_header_callback(GContext* ctx, const Layer *cell_layer, uint16_t section_index, void *data);
@@ -149,10 +193,28 @@ static uint16_t profile_menu_get_num_rows_callback(MenuLayer *menu_layer, uint16
 static int16_t profile_menu_get_header_height_callback(MenuLayer *menu_layer, uint16_t section_index, void *data);
 static void profile_menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuIndex *cell_index, void *data);
 static void profile_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data);
+static void profile_menu_update_stats();
 static void profile_menu_show();
 static void profile_menu_window_load(Window *window);
 static void profile_menu_window_unload(Window *window);
 
+static Window *chart_window;
+static Layer *chart_layer;
+static PyramidLevel chart_level;
+// Number of buckets the newest bar is scrolled back from the current one
+static uint16_t chart_offset;
+static const char* chart_level_to_string(PyramidLevel level);
+static uint8_t chart_columns();
+static int16_t chart_bar_height(uint16_t oz, int16_t chart_height);
+static void chart_layer_update_proc(Layer *layer, GContext *ctx);
+static void chart_select_click_handler(ClickRecognizerRef recognizer, void *context);
+static void chart_up_click_handler(ClickRecognizerRef recognizer, void *context);
+static void chart_down_click_handler(ClickRecognizerRef recognizer, void *context);
+static void chart_click_config_provider(void *context);
+static void chart_show();
+static void chart_window_load(Window *window);
+static void chart_window_unload(Window *window);
+
 static Window *unit_system_menu_window;
 static MenuLayer *unit_system_menu_layer;
 static void unit_system_menu_draw_header_callback(GContext* ctx, const Layer *cell_layer, uint16_t section_index, void *data);
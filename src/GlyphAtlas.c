@@ -0,0 +1,231 @@
+#include <pebble.h>
+#include "GlyphAtlas.h"
+
+static int8_t find_glyph(const GlyphAtlas *atlas, char c) {
+    const char *found = strchr(atlas->glyphs, c);
+    return (c != '\0' && found) ? found - atlas->glyphs : -1;
+}
+
+// Drops the rendered glyphs so that they're rendered again when next needed
+static void invalidate(GlyphAtlas *atlas) {
+    if (atlas->bitmap) {
+        gbitmap_destroy(atlas->bitmap);
+        atlas->bitmap = NULL;
+    }
+}
+
+void glyph_atlas_init(GlyphAtlas *atlas, GFont font, const char *glyphs) {
+    memset(atlas, 0, sizeof(GlyphAtlas));
+    atlas->font = font;
+    glyph_atlas_add_glyphs(atlas, glyphs);
+}
+
+void glyph_atlas_deinit(GlyphAtlas *atlas) {
+    invalidate(atlas);
+}
+
+// Makes sure every character of text has a glyph, as far as there's room
+void glyph_atlas_add_glyphs(GlyphAtlas *atlas, const char *text) {
+    uint8_t count = strlen(atlas->glyphs);
+    for (const char *c = text; *c && count < GLYPH_ATLAS_MAX_GLYPHS; c++) {
+        if (find_glyph(atlas, *c) < 0) {
+            atlas->glyphs[count++] = *c;
+            atlas->glyphs[count] = '\0';
+            invalidate(atlas);
+            atlas->failed = false;
+        }
+    }
+}
+
+bool glyph_atlas_is_rendered(const GlyphAtlas *atlas) {
+    return atlas->bitmap != NULL;
+}
+
+// Rendering is only tried again once a glyph is added after it failed
+bool glyph_atlas_needs_render(const GlyphAtlas *atlas) {
+    return !atlas->bitmap && !atlas->failed;
+}
+
+// Reads a pixel of the frame buffer, which on round displays only has the
+// part of each row that is on screen
+static uint8_t read_pixel(const GBitmapDataRowInfo *row, bool one_bit, int16_t x) {
+    if (x < row->min_x || x > row->max_x) {
+        return one_bit ? 1 : GColorWhiteARGB8;
+    }
+    return one_bit ? (row->data[x / 8] >> (x % 8)) & 1 : row->data[x];
+}
+
+// Copies the glyphs drawn into frame (in screen coordinates) into the atlas.
+// On color displays white is made transparent so that text can be drawn over
+// other layers, like a TextLayer with a clear background.
+static bool copy_from_frame_buffer(GlyphAtlas *atlas, GContext *ctx, GRect frame, GSize size) {
+    GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+    if (!frame_buffer) {
+        return false;
+    }
+    bool one_bit = gbitmap_get_format(frame_buffer) == GBitmapFormat1Bit;
+    atlas->bitmap = gbitmap_create_blank(size, one_bit ? GBitmapFormat1Bit : GBitmapFormat8Bit);
+    if (atlas->bitmap) {
+        uint8_t *data = gbitmap_get_data(atlas->bitmap);
+        uint16_t bytes_per_row = gbitmap_get_bytes_per_row(atlas->bitmap);
+        for (int16_t y = 0; y < size.h; y++) {
+            GBitmapDataRowInfo row = gbitmap_get_data_row_info(frame_buffer, frame.origin.y + y);
+            uint8_t *out = data + y * bytes_per_row;
+            memset(out, 0, bytes_per_row);
+            for (int16_t x = 0; x < size.w; x++) {
+                uint8_t pixel = read_pixel(&row, one_bit, frame.origin.x + x);
+                if (one_bit) {
+                    out[x / 8] |= pixel << (x % 8);
+                } else {
+                    out[x] = (pixel == GColorWhiteARGB8) ? 0 : pixel;
+                }
+            }
+        }
+    }
+    graphics_release_frame_buffer(ctx, frame_buffer);
+    return atlas->bitmap != NULL;
+}
+
+// The columns, in screen coordinates and within frame, that every row from
+// top to top + height shows. Round displays only show the middle of the rows
+// near their top and bottom.
+static bool find_visible_columns(GContext *ctx, GRect frame, int16_t top, int16_t height,
+        int16_t *min_x, int16_t *max_x) {
+    GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+    if (!frame_buffer) {
+        return false;
+    }
+    *min_x = frame.origin.x;
+    *max_x = frame.origin.x + frame.size.w - 1;
+    for (int16_t y = top; y < top + height; y++) {
+        GBitmapDataRowInfo row = gbitmap_get_data_row_info(frame_buffer, y);
+        if (row.min_x > *min_x) *min_x = row.min_x;
+        if (row.max_x < *max_x) *max_x = row.max_x;
+    }
+    graphics_release_frame_buffer(ctx, frame_buffer);
+    return *max_x >= *min_x;
+}
+
+// Places the measured cells in rows no wider than width and returns the size
+// they take up
+static GSize lay_out_cells(GlyphAtlas *atlas, uint8_t count, int16_t width, int16_t row_height) {
+    int16_t x = 0, y = 0, used = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        GRect *cell = &atlas->cells[i];
+        if (x > 0 && x + cell->size.w > width) {
+            x = 0;
+            y += row_height;
+        }
+        cell->origin = GPoint(x, y);
+        x += cell->size.w;
+        if (x > used) used = x;
+    }
+    return GSize(used, y + row_height);
+}
+
+// Lays the glyphs out in rows in the middle of the layer being drawn, whose
+// frame is given in screen coordinates, draws them and keeps a copy of them.
+// On round displays the rows are narrowed until all of them are on screen.
+// Returns false if they don't fit or there's no memory for them.
+bool glyph_atlas_render(GlyphAtlas *atlas, GContext *ctx, GRect frame) {
+    invalidate(atlas);
+    uint8_t count = strlen(atlas->glyphs);
+    GRect box = GRect(0, 0, frame.size.w, frame.size.h);
+    char glyph[2] = { 0 };
+
+    int16_t row_height = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        glyph[0] = atlas->glyphs[i];
+        GSize size = graphics_text_layout_get_content_size(glyph, atlas->font, box,
+            GTextOverflowModeFill, GTextAlignmentLeft);
+        atlas->cells[i].size = size;
+        if (size.h > row_height) row_height = size.h;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        // Spaces have no ink, so give them the width of a thin glyph
+        if (atlas->cells[i].size.w == 0) atlas->cells[i].size.w = row_height / 4;
+        atlas->cells[i].size.h = row_height;
+    }
+    if (count == 0) {
+        atlas->failed = true;
+        return false;
+    }
+
+    // Narrower rows need more of them, which can reach further out of the
+    // circle, so this takes a few tries at most
+    GRect area = GRectZero;
+    int16_t width = frame.size.w;
+    for (uint8_t attempt = 0; attempt < 4 && area.size.w == 0; attempt++) {
+        GSize size = lay_out_cells(atlas, count, width, row_height);
+        int16_t top = (frame.size.h - size.h) / 2;
+        int16_t min_x, max_x;
+        if (size.h > frame.size.h ||
+                !find_visible_columns(ctx, frame, frame.origin.y + top, size.h, &min_x, &max_x)) {
+            break;
+        }
+        width = max_x - min_x + 1;
+        if (size.w <= width) {
+            area = GRect(min_x - frame.origin.x + (width - size.w) / 2, top, size.w, size.h);
+        }
+    }
+    if (area.size.w == 0) {
+        atlas->failed = true;
+        return false;
+    }
+
+    graphics_context_set_fill_color(ctx, GColorWhite);
+    graphics_fill_rect(ctx, area, 0, GCornerNone);
+    graphics_context_set_text_color(ctx, GColorBlack);
+    for (uint8_t i = 0; i < count; i++) {
+        glyph[0] = atlas->glyphs[i];
+        GRect cell = atlas->cells[i];
+        graphics_draw_text(ctx, glyph, atlas->font,
+            GRect(area.origin.x + cell.origin.x, area.origin.y + cell.origin.y, frame.size.w, row_height),
+            GTextOverflowModeFill, GTextAlignmentLeft, NULL);
+    }
+
+    GRect screen_area = GRect(frame.origin.x + area.origin.x, frame.origin.y + area.origin.y,
+        area.size.w, area.size.h);
+    bool copied = copy_from_frame_buffer(atlas, ctx, screen_area, area.size);
+    graphics_fill_rect(ctx, area, 0, GCornerNone);
+    atlas->failed = !copied;
+    return copied;
+}
+
+bool glyph_atlas_covers(const GlyphAtlas *atlas, const char *text) {
+    if (!atlas->bitmap) {
+        return false;
+    }
+    for (const char *c = text; *c; c++) {
+        if (find_glyph(atlas, *c) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int16_t glyph_atlas_text_width(const GlyphAtlas *atlas, const char *text) {
+    int16_t width = 0;
+    for (const char *c = text; *c; c++) {
+        int8_t i = find_glyph(atlas, *c);
+        if (i >= 0) width += atlas->cells[i].size.w;
+    }
+    return width;
+}
+
+// Blits text one glyph at a time, leaving the background as it is. Only
+// draws anything if glyph_atlas_covers() the text.
+void glyph_atlas_draw_text(GlyphAtlas *atlas, GContext *ctx, const char *text, GPoint origin) {
+    if (!glyph_atlas_covers(atlas, text)) {
+        return;
+    }
+    GRect full = gbitmap_get_bounds(atlas->bitmap);
+    graphics_context_set_compositing_mode(ctx, PBL_IF_COLOR_ELSE(GCompOpSet, GCompOpAnd));
+    for (const char *c = text; *c; c++) {
+        GRect cell = atlas->cells[find_glyph(atlas, *c)];
+        gbitmap_set_bounds(atlas->bitmap, cell);
+        graphics_draw_bitmap_in_rect(ctx, atlas->bitmap, GRect(origin.x, origin.y, cell.size.w, cell.size.h));
+        origin.x += cell.size.w;
+    }
+    gbitmap_set_bounds(atlas->bitmap, full);
+}
@@ -0,0 +1,40 @@
+/*
+  Pre-rendered glyphs for text that changes often.
+
+  Drawing text lays it out again every time, which is most of the cost of
+  redrawing the volume counter while a button is held. An atlas draws each
+  glyph once with graphics_draw_text(), copies the result out of the frame
+  buffer and from then on draws text with one bitmap blit per character,
+  each at its own advance width and without kerning.
+
+  Rendering needs the frame buffer, so it's done from an update proc by
+  glyph_atlas_render(), which clears what it drew to white again. Its layer
+  should be drawn before anything else in a window with a white background.
+  The glyphs go in the middle of the layer, where round displays show every
+  row they use.
+*/
+
+#pragma once
+#include <pebble.h>
+
+#define GLYPH_ATLAS_MAX_GLYPHS 32
+
+typedef struct {
+    GFont font;
+    GBitmap *bitmap;
+    char glyphs[GLYPH_ATLAS_MAX_GLYPHS + 1];
+    // Where each glyph is in bitmap, valid once it is rendered
+    GRect cells[GLYPH_ATLAS_MAX_GLYPHS];
+    // Set when rendering failed, cleared when a glyph is added
+    bool failed;
+} GlyphAtlas;
+
+void glyph_atlas_init(GlyphAtlas *atlas, GFont font, const char *glyphs);
+void glyph_atlas_deinit(GlyphAtlas *atlas);
+void glyph_atlas_add_glyphs(GlyphAtlas *atlas, const char *text);
+bool glyph_atlas_is_rendered(const GlyphAtlas *atlas);
+bool glyph_atlas_needs_render(const GlyphAtlas *atlas);
+bool glyph_atlas_render(GlyphAtlas *atlas, GContext *ctx, GRect frame);
+bool glyph_atlas_covers(const GlyphAtlas *atlas, const char *text);
+int16_t glyph_atlas_text_width(const GlyphAtlas *atlas, const char *text);
+void glyph_atlas_draw_text(GlyphAtlas *atlas, GContext *ctx, const char *text, GPoint origin);
@@ -0,0 +1,81 @@
+#include "PebbleApi.h"
+#include "History.h"
+#include "PagedStore.h"
+
+#define OZ_IN_GAL 128
+
+static PagedStore store;
+
+uint8_t history_encode(uint16_t volume, uint16_t goal_volume, bool metric, bool half_gallon) {
+    uint8_t level = HISTORY_FULL;
+    if (volume < goal_volume) {
+        // Rounds down so only a met goal is stored as HISTORY_FULL
+        level = (uint32_t)volume * HISTORY_FULL / goal_volume;
+    }
+    return level | (metric ? HISTORY_METRIC_FLAG : 0) | (half_gallon ? HISTORY_HALF_GALLON_FLAG : 0);
+}
+
+uint8_t history_level(uint8_t record) {
+    return record & HISTORY_LEVEL_MASK;
+}
+
+bool history_goal_met(uint8_t record) {
+    return history_level(record) == HISTORY_FULL;
+}
+
+// Approximate volume drunk that day, in ounces whatever the unit system was
+uint16_t history_volume_oz(uint8_t record) {
+    uint16_t goal_oz = (record & HISTORY_HALF_GALLON_FLAG) ? OZ_IN_GAL / 2 : OZ_IN_GAL;
+    return (history_level(record) * goal_oz + HISTORY_FULL / 2) / HISTORY_FULL;
+}
+
+void history_init() {
+    paged_store_init(&store, HISTORY_KEY, HISTORY_PAGES);
+}
+
+void history_deinit() {
+    paged_store_deinit(&store);
+}
+
+void history_flush() {
+    paged_store_flush(&store);
+}
+
+// Stores the record for a day. Days skipped since the last record (when the
+// app wasn't opened) are stored as nothing drunk under the same settings.
+void history_append(uint32_t day, uint8_t record) {
+    bool empty = paged_store_length(&store) == 0;
+    uint32_t end = history_end_day();
+
+    if (!empty && day > end) {
+        uint8_t missed = record & ~HISTORY_LEVEL_MASK;
+        // Anything older than the capacity would be evicted right away
+        if (day - end > paged_store_capacity(&store)) {
+            end = day - paged_store_capacity(&store);
+        }
+        for (; end < day; end++) {
+            paged_store_write(&store, end, &missed, 1);
+        }
+    }
+
+    paged_store_write(&store, day, &record, 1);
+
+    // The first record starts the history, nothing before it is valid
+    if (empty) {
+        paged_store_discard_before(&store, day);
+    }
+}
+
+bool history_read(uint32_t day, uint8_t *record) {
+    return paged_store_read(&store, day, record, 1) == 1;
+}
+
+// First day that is still stored
+uint32_t history_first_day() {
+    return paged_store_start(&store);
+}
+
+// One past the last day that was stored
+uint32_t history_end_day() {
+    return paged_store_length(&store);
+}
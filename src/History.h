@@ -0,0 +1,44 @@
+/*
+  Daily intake history.
+
+  Every finished day is stored as a single byte, indexed by its day number
+  (days since the epoch, counted from the user's end of day), in a paged store
+  so that reading or appending any day is O(1):
+
+    bit 7     day was tracked in the metric unit system
+    bit 6     day's goal was a half gallon instead of a gallon
+    bits 0-5  intake as a fraction of that day's goal, 0 to HISTORY_FULL
+
+  Anything drunk past the goal is not recorded: a met goal is stored as
+  HISTORY_FULL whatever the volume. The app never counts past the goal
+  anyway, see clamp_volume_to_goal(). Below the goal a level is 1/63 of it,
+  2 oz for a gallon, rounded down.
+
+  HISTORY_PAGES pages hold HISTORY_PAGES * 256 days (about 3.5 years) before
+  the oldest days are evicted.
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+#define HISTORY_KEY 3000
+#define HISTORY_PAGES 5
+
+#define HISTORY_METRIC_FLAG 0x80
+#define HISTORY_HALF_GALLON_FLAG 0x40
+#define HISTORY_LEVEL_MASK 0x3f
+// Level of a day where the goal was met
+#define HISTORY_FULL HISTORY_LEVEL_MASK
+
+uint8_t history_encode(uint16_t volume, uint16_t goal_volume, bool metric, bool half_gallon);
+uint8_t history_level(uint8_t record);
+bool history_goal_met(uint8_t record);
+uint16_t history_volume_oz(uint8_t record);
+
+void history_init();
+void history_deinit();
+void history_flush();
+void history_append(uint32_t day, uint8_t record);
+bool history_read(uint32_t day, uint8_t *record);
+uint32_t history_first_day();
+uint32_t history_end_day();
@@ -0,0 +1,140 @@
+#include "PebbleApi.h"
+#include "IntakeIndex.h"
+#include "PagedStore.h"
+
+static PagedStore store;
+// One past the newest day in the index
+static uint32_t end_day;
+static bool end_day_dirty;
+
+static uint16_t read_node(uint16_t i) {
+    uint16_t value = 0;
+    paged_store_read(&store, (i - 1) * sizeof(value), &value, sizeof(value));
+    return value;
+}
+
+static void add_to_slot(uint16_t slot, uint16_t delta) {
+    for (uint16_t i = slot + 1; i <= INTAKE_INDEX_DAYS; i += i & -i) {
+        uint16_t value = read_node(i) + delta;
+        paged_store_write(&store, (i - 1) * sizeof(value), &value, sizeof(value));
+    }
+}
+
+// Sum of the slots before count
+static uint16_t prefix_sum(uint16_t count) {
+    uint16_t sum = 0;
+    for (uint16_t i = count; i > 0; i -= i & -i) {
+        sum += read_node(i);
+    }
+    return sum;
+}
+
+static uint16_t slot_value(uint16_t slot) {
+    return prefix_sum(slot + 1) - prefix_sum(slot);
+}
+
+static void set_slot(uint16_t slot, uint16_t value) {
+    uint16_t delta = value - slot_value(slot);
+    if (delta) {
+        add_to_slot(slot, delta);
+    }
+}
+
+// Oldest day that is still in the index
+static uint32_t first_day_in_index() {
+    return (end_day > INTAKE_INDEX_DAYS - 1) ? end_day - (INTAKE_INDEX_DAYS - 1) : 0;
+}
+
+void intake_index_init() {
+    paged_store_init(&store, INTAKE_INDEX_KEY, INTAKE_INDEX_PAGES);
+    end_day = persist_exists(INTAKE_INDEX_END_KEY) ? persist_read_int(INTAKE_INDEX_END_KEY) : 0;
+    end_day_dirty = false;
+}
+
+void intake_index_deinit() {
+    intake_index_flush();
+    paged_store_deinit(&store);
+}
+
+void intake_index_flush() {
+    paged_store_flush(&store);
+    if (end_day_dirty) {
+        persist_write_int(INTAKE_INDEX_END_KEY, end_day);
+        end_day_dirty = false;
+    }
+}
+
+void intake_index_set(uint32_t day, uint16_t oz) {
+    if (oz > INTAKE_INDEX_MAX_OZ) oz = INTAKE_INDEX_MAX_OZ;
+    if (end_day == 0) {
+        end_day = day;
+    }
+
+    if (day >= end_day) {
+        if (day - end_day >= INTAKE_INDEX_DAYS) {
+            // Nothing in the index is recent enough to keep
+            paged_store_clear(&store);
+        } else {
+            // Days that were skipped take over the slots of days that are now
+            // too old, so clear them
+            for (uint32_t skipped = end_day; skipped < day; skipped++) {
+                set_slot(skipped % INTAKE_INDEX_DAYS, 0);
+            }
+        }
+        end_day = day + 1;
+        end_day_dirty = true;
+    } else if (day < first_day_in_index()) {
+        return;
+    }
+
+    set_slot(day % INTAKE_INDEX_DAYS, oz);
+}
+
+uint16_t intake_index_get(uint32_t day) {
+    if (day >= end_day || day < first_day_in_index()) {
+        return 0;
+    }
+    return slot_value(day % INTAKE_INDEX_DAYS);
+}
+
+// Total of a range of at most INTAKE_INDEX_CHUNK_DAYS days in the index
+static uint16_t chunk_sum(uint32_t first_day, uint32_t end) {
+    uint16_t first_slot = first_day % INTAKE_INDEX_DAYS;
+    uint16_t end_slot = (end - 1) % INTAKE_INDEX_DAYS + 1;
+    if (first_slot < end_slot) {
+        return prefix_sum(end_slot) - prefix_sum(first_slot);
+    }
+    // The range wraps around the end of the slots
+    return prefix_sum(INTAKE_INDEX_DAYS) - prefix_sum(first_slot) + prefix_sum(end_slot);
+}
+
+// Ounces drunk over the days in [first_day, end), limited to the days that are
+// still in the index
+uint32_t intake_index_sum(uint32_t first_day, uint32_t end) {
+    if (first_day < first_day_in_index()) first_day = first_day_in_index();
+    if (end > end_day) end = end_day;
+
+    uint32_t sum = 0;
+    while (first_day < end) {
+        uint32_t chunk_end = (end - first_day > INTAKE_INDEX_CHUNK_DAYS) ? first_day + INTAKE_INDEX_CHUNK_DAYS : end;
+        sum += chunk_sum(first_day, chunk_end);
+        first_day = chunk_end;
+    }
+    return sum;
+}
+
+// Finds the most and least drunk in any of the 7 day weeks ending at end and
+// going back to first_day. Returns false if there isn't a full week.
+bool intake_index_week_extremes(uint32_t first_day, uint32_t end, uint16_t *best, uint16_t *worst) {
+    if (first_day < first_day_in_index()) first_day = first_day_in_index();
+    if (end > end_day) end = end_day;
+
+    bool found = false;
+    for (; end >= first_day + 7; end -= 7) {
+        uint16_t week = intake_index_sum(end - 7, end);
+        if (!found || week > *best) *best = week;
+        if (!found || week < *worst) *worst = week;
+        found = true;
+    }
+    return found;
+}
@@ -0,0 +1,34 @@
+/*
+  Prefix-sum index over daily intake.
+
+  A Fenwick tree of INTAKE_INDEX_DAYS slots, where day number d lives in slot
+  d % INTAKE_INDEX_DAYS, holds the ounces drunk on each of the most recent
+  days. Changing a day and summing any range of days both take O(log n), so
+  the profile's totals don't need to walk the history.
+
+  Nodes are 16 bit and wrap around, so a range sum read from the tree is only
+  exact while the range's true total fits in 16 bits. Days are capped at
+  INTAKE_INDEX_MAX_OZ, like the pyramid does, and intake_index_sum() adds
+  longer ranges up in chunks of INTAKE_INDEX_CHUNK_DAYS days, whose totals
+  always fit. Sums of any range in the index are exact up to that cap.
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+#define INTAKE_INDEX_KEY 3020
+#define INTAKE_INDEX_END_KEY 3029
+#define INTAKE_INDEX_DAYS 512
+#define INTAKE_INDEX_PAGES 4
+// Most ounces kept for one day
+#define INTAKE_INDEX_MAX_OZ UINT8_MAX
+// Longest range whose total always fits in a 16 bit node
+#define INTAKE_INDEX_CHUNK_DAYS (UINT16_MAX / INTAKE_INDEX_MAX_OZ)
+
+void intake_index_init();
+void intake_index_deinit();
+void intake_index_flush();
+void intake_index_set(uint32_t day, uint16_t oz);
+uint16_t intake_index_get(uint32_t day);
+uint32_t intake_index_sum(uint32_t first_day, uint32_t end_day);
+bool intake_index_week_extremes(uint32_t first_day, uint32_t end_day, uint16_t *best, uint16_t *worst);
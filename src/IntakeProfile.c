@@ -0,0 +1,94 @@
+#include "PebbleApi.h"
+#include "IntakeProfile.h"
+
+typedef struct __attribute__((__packed__)) {
+    // Days learned so far, saturating
+    uint8_t days;
+    uint16_t hours[INTAKE_PROFILE_HOURS];
+} IntakeProfile;
+
+static IntakeProfile profile;
+static bool profile_dirty;
+
+void intake_profile_init() {
+    memset(&profile, 0, sizeof(profile));
+    persist_read_data(INTAKE_PROFILE_KEY, &profile, sizeof(profile));
+    profile_dirty = false;
+}
+
+void intake_profile_deinit() {
+    intake_profile_flush();
+}
+
+void intake_profile_flush() {
+    if (profile_dirty) {
+        persist_write_data(INTAKE_PROFILE_KEY, &profile, sizeof(profile));
+        profile_dirty = false;
+    }
+}
+
+// Folds a finished day into the averages. The first days are weighed as a
+// plain mean so that the profile doesn't start out biased towards zero. Days
+// where nothing was logged say nothing about the cadence and are skipped.
+void intake_profile_add_day(const int32_t *hourly_ml) {
+    int32_t total = 0;
+    for (uint8_t h = 0; h < INTAKE_PROFILE_HOURS; h++) {
+        if (hourly_ml[h] > 0) total += hourly_ml[h];
+    }
+    if (total == 0) {
+        return;
+    }
+
+    uint8_t shift = INTAKE_PROFILE_DECAY_SHIFT;
+    uint8_t weight = (profile.days < (1 << shift)) ? profile.days + 1 : (1 << shift);
+    for (uint8_t h = 0; h < INTAKE_PROFILE_HOURS; h++) {
+        int32_t ml = (hourly_ml[h] > 0) ? hourly_ml[h] : 0;
+        int32_t sample = ml << INTAKE_PROFILE_FRACTION_BITS;
+        if (sample > UINT16_MAX) sample = UINT16_MAX;
+        int32_t value = profile.hours[h];
+        profile.hours[h] = value + (sample - value) / weight;
+    }
+    if (profile.days < UINT8_MAX) profile.days++;
+    profile_dirty = true;
+}
+
+bool intake_profile_ready() {
+    return profile.days >= INTAKE_PROFILE_MIN_DAYS;
+}
+
+// Minute of the day by which the usual pace has drunk fraction (out of
+// INTAKE_PROFILE_ONE) of the day's intake, spreading each hour's share
+// evenly over it
+uint16_t intake_profile_minute_for(uint32_t fraction) {
+    uint32_t total = 0;
+    for (uint8_t h = 0; h < INTAKE_PROFILE_HOURS; h++) {
+        total += profile.hours[h];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint32_t target = ((uint64_t)total * fraction + INTAKE_PROFILE_ONE - 1) / INTAKE_PROFILE_ONE;
+    uint32_t sum = 0;
+    for (uint8_t h = 0; h < INTAKE_PROFILE_HOURS; h++) {
+        uint32_t value = profile.hours[h];
+        if (value > 0 && sum + value >= target) {
+            return h * 60 + (target - sum) * 60 / value;
+        }
+        sum += value;
+    }
+    return INTAKE_PROFILE_HOURS * 60;
+}
+
+// How much the usual pace still drinks from minute to the end of the day
+uint32_t intake_profile_ml_after(uint16_t minute) {
+    uint32_t sum = 0;
+    for (uint8_t h = minute / 60; h < INTAKE_PROFILE_HOURS; h++) {
+        uint32_t value = profile.hours[h];
+        if (h == minute / 60) {
+            value = value * (60 - minute % 60) / 60;
+        }
+        sum += value;
+    }
+    return sum >> INTAKE_PROFILE_FRACTION_BITS;
+}
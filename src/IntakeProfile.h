@@ -0,0 +1,33 @@
+/*
+  Learned drinking cadence.
+
+  Keeps how much is usually drunk in each hour of the day, counted from the
+  end of day hour, as an exponentially decayed average over the finished
+  days. Averages are kept in fixed point with INTAKE_PROFILE_FRACTION_BITS
+  fractional bits, and each new day weighs 1 / 2^INTAKE_PROFILE_DECAY_SHIFT,
+  so the profile follows the last week or so.
+
+  The auto reminders use it to find when the usual pace gets ahead of what
+  was drunk so far, see intake_profile_minute_for(), and whether keeping to
+  it would still meet the goal, see intake_profile_ml_after().
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+#define INTAKE_PROFILE_KEY 3050
+#define INTAKE_PROFILE_HOURS 24
+#define INTAKE_PROFILE_FRACTION_BITS 4
+#define INTAKE_PROFILE_DECAY_SHIFT 3
+// Days needed before the profile is trusted
+#define INTAKE_PROFILE_MIN_DAYS 3
+// A whole day's intake in intake_profile_minute_for()
+#define INTAKE_PROFILE_ONE 0x10000
+
+void intake_profile_init();
+void intake_profile_deinit();
+void intake_profile_flush();
+void intake_profile_add_day(const int32_t *hourly_ml);
+bool intake_profile_ready();
+uint16_t intake_profile_minute_for(uint32_t fraction);
+uint32_t intake_profile_ml_after(uint16_t minute);
@@ -0,0 +1,138 @@
+#include "PebbleApi.h"
+#include "IntakePyramid.h"
+#include "PagedStore.h"
+#include "CivilDate.h"
+
+// Buckets kept per level: 52 weeks, a day or two short of a year, and two
+// years of months. 53 weeks wouldn't fit in INTAKE_PYRAMID_PAGES.
+static const uint16_t capacities[PYRAMID_LEVELS] = { 52, 24, 8 };
+
+// Buckets as they are stored. Versions that kept the sum in 16 bits left the
+// high bits of days_and_sum_high zero, so their buckets read the same.
+typedef struct __attribute__((__packed__)) {
+    uint16_t sum_low;
+    // Days in the low STORED_DAYS_BITS bits, bits 16 and up of the sum above
+    uint16_t days_and_sum_high;
+    uint8_t min;
+    uint8_t max;
+} StoredBucket;
+
+#define STORED_DAYS_BITS 9
+#define STORED_DAYS_MASK ((1 << STORED_DAYS_BITS) - 1)
+
+typedef struct __attribute__((__packed__)) {
+    // Newest bucket stored for each level, 0 while the level is empty
+    uint16_t newest[PYRAMID_LEVELS];
+    uint16_t reserved;
+} PyramidHeader;
+
+static PagedStore store;
+static PyramidHeader header;
+static bool header_dirty;
+
+static uint32_t bucket_offset(PyramidLevel level, uint32_t bucket) {
+    uint32_t offset = sizeof(PyramidHeader);
+    for (uint8_t i = 0; i < level; i++) {
+        offset += capacities[i] * sizeof(StoredBucket);
+    }
+    return offset + (bucket % capacities[level]) * sizeof(StoredBucket);
+}
+
+static void write_bucket(PyramidLevel level, uint32_t bucket, const PyramidBucket *value) {
+    StoredBucket stored = {
+        .sum_low = value->sum & 0xFFFF,
+        .days_and_sum_high = (value->days & STORED_DAYS_MASK) | ((value->sum >> 16) << STORED_DAYS_BITS),
+        .min = value->min,
+        .max = value->max,
+    };
+    paged_store_write(&store, bucket_offset(level, bucket), &stored, sizeof(stored));
+}
+
+static bool is_stored(PyramidLevel level, uint32_t bucket) {
+    uint16_t newest = header.newest[level];
+    return newest != 0 && bucket <= newest && bucket + capacities[level] > newest;
+}
+
+void intake_pyramid_init() {
+    paged_store_init(&store, INTAKE_PYRAMID_KEY, INTAKE_PYRAMID_PAGES);
+    memset(&header, 0, sizeof(header));
+    paged_store_read(&store, 0, &header, sizeof(header));
+    header_dirty = false;
+}
+
+void intake_pyramid_deinit() {
+    intake_pyramid_flush();
+    paged_store_deinit(&store);
+}
+
+void intake_pyramid_flush() {
+    if (header_dirty) {
+        paged_store_write(&store, 0, &header, sizeof(header));
+        header_dirty = false;
+    }
+    paged_store_flush(&store);
+}
+
+uint32_t intake_pyramid_bucket_of(PyramidLevel level, uint32_t day) {
+    if (level == PYRAMID_WEEK) {
+        // Day 0 was a Thursday, this makes weeks start on Sunday
+        return (day + 4) / 7;
+    }
+
+    // Months and years are counted from 1900
+    CivilDate date = civil_from_days(day);
+    return (level == PYRAMID_MONTH) ? (date.year - 1900) * 12 + date.month - 1 : date.year - 1900;
+}
+
+uint16_t intake_pyramid_capacity(PyramidLevel level) {
+    return capacities[level];
+}
+
+// Adds a finished day to its bucket on every level
+void intake_pyramid_add_day(uint32_t day, uint16_t oz) {
+    if (oz > UINT8_MAX) oz = UINT8_MAX;
+
+    for (PyramidLevel level = PYRAMID_WEEK; level < PYRAMID_LEVELS; level++) {
+        uint32_t bucket = intake_pyramid_bucket_of(level, day);
+        PyramidBucket value = { .sum = 0, .days = 0, .min = UINT8_MAX, .max = 0 };
+
+        if (bucket > header.newest[level]) {
+            // Start a new bucket, emptying the ones skipped on the way
+            uint32_t first = header.newest[level] + 1;
+            if (header.newest[level] == 0 || bucket - first >= capacities[level]) {
+                first = bucket - capacities[level] + 1;
+            }
+            for (uint32_t skipped = first; skipped < bucket; skipped++) {
+                write_bucket(level, skipped, &value);
+            }
+            header.newest[level] = bucket;
+            header_dirty = true;
+        } else if (is_stored(level, bucket)) {
+            intake_pyramid_read(level, bucket, &value);
+        } else {
+            continue;
+        }
+
+        value.sum += oz;
+        value.days++;
+        if (oz < value.min) value.min = oz;
+        if (oz > value.max) value.max = oz;
+        write_bucket(level, bucket, &value);
+    }
+}
+
+// Reads one bucket, returning false if it's too old or was never filled
+bool intake_pyramid_read(PyramidLevel level, uint32_t bucket, PyramidBucket *out) {
+    if (!is_stored(level, bucket)) {
+        return false;
+    }
+    StoredBucket stored;
+    if (paged_store_read(&store, bucket_offset(level, bucket), &stored, sizeof(stored)) != sizeof(stored)) {
+        return false;
+    }
+    out->sum = stored.sum_low | ((uint32_t)(stored.days_and_sum_high >> STORED_DAYS_BITS) << 16);
+    out->days = stored.days_and_sum_high & STORED_DAYS_MASK;
+    out->min = stored.min;
+    out->max = stored.max;
+    return out->days > 0;
+}
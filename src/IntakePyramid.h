@@ -0,0 +1,41 @@
+/*
+  Multi-resolution intake summaries for the history chart.
+
+  Every finished day is added to the bucket of its week, calendar month and
+  calendar year. Each bucket keeps the total, lowest and highest daily intake
+  in ounces and the number of days added, so the chart reads exactly one
+  bucket per bar whatever the zoom level. Each level is a ring of its most
+  recent buckets.
+
+  A stored bucket is 6 bytes. The days fit in 9 bits, so the high bits of a
+  sum past 16 bits are kept above them, see StoredBucket.
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+#define INTAKE_PYRAMID_KEY 3030
+#define INTAKE_PYRAMID_PAGES 2
+
+typedef enum {
+    PYRAMID_WEEK,
+    PYRAMID_MONTH,
+    PYRAMID_YEAR,
+    PYRAMID_LEVELS
+} PyramidLevel;
+
+typedef struct {
+    // A year of days at up to 255 oz doesn't fit in 16 bits
+    uint32_t sum;
+    uint16_t days;
+    uint8_t min;
+    uint8_t max;
+} PyramidBucket;
+
+void intake_pyramid_init();
+void intake_pyramid_deinit();
+void intake_pyramid_flush();
+void intake_pyramid_add_day(uint32_t day, uint16_t oz);
+uint32_t intake_pyramid_bucket_of(PyramidLevel level, uint32_t day);
+uint16_t intake_pyramid_capacity(PyramidLevel level);
+bool intake_pyramid_read(PyramidLevel level, uint32_t bucket, PyramidBucket *out);
@@ -7,6 +7,6 @@
 
 #pragma once
   
-time_t p_mktime(struct tm *tmptr);
+// p_mktime() was replaced by CivilDate.h, which is valid past 2020
 //char *p_strtok(char *s1, const char *s2);
 //long int p_strtol(const char *nptr, char **endptr, int base);
@@ -0,0 +1,253 @@
+#include "PebbleApi.h"
+#include "PagedStore.h"
+
+typedef struct __attribute__((__packed__)) {
+    uint8_t max_pages;
+    uint32_t start;
+    uint32_t length;
+} PagedStoreMeta;
+
+// Pages handed out to all initialized stores, see PAGED_STORE_QUOTA_PAGES
+static uint8_t pages_reserved = 0;
+
+static uint32_t page_key(const PagedStore *store, uint32_t page) {
+    return store->meta_key + 1 + page % store->max_pages;
+}
+
+static uint32_t first_page(const PagedStore *store) {
+    return store->start / PAGED_STORE_PAGE_SIZE;
+}
+
+static void write_back(PagedStore *store, PagedStoreCacheEntry *entry) {
+    if (entry->data && entry->dirty) {
+        persist_write_data(page_key(store, entry->page), entry->data, PAGED_STORE_PAGE_SIZE);
+        entry->dirty = false;
+    }
+}
+
+// Returns the cached copy of a page, loading it (or evicting the least
+// recently used page to make room for it) if needed. Only pages below
+// persisted_length have ever been written out.
+static uint8_t* get_page(PagedStore *store, uint32_t page, uint32_t persisted_length, bool for_write) {
+    PagedStoreCacheEntry *entry = NULL;
+    for (uint8_t i = 0; i < PAGED_STORE_CACHE_PAGES; i++) {
+        PagedStoreCacheEntry *candidate = &store->cache[i];
+        if (candidate->data && candidate->page == page) {
+            entry = candidate;
+            break;
+        }
+        if (!entry || !candidate->data ||
+                (entry->data && candidate->last_used < entry->last_used)) {
+            entry = candidate;
+        }
+    }
+
+    if (!entry->data || entry->page != page) {
+        if (!entry->data) {
+            entry->data = malloc(PAGED_STORE_PAGE_SIZE);
+            if (!entry->data) {
+                return NULL;
+            }
+        }
+        write_back(store, entry);
+
+        entry->page = page;
+        entry->dirty = false;
+        memset(entry->data, 0, PAGED_STORE_PAGE_SIZE);
+        // Pages past the end were never written, and their key may still hold
+        // an evicted page that shared the same slot
+        if (page * PAGED_STORE_PAGE_SIZE < persisted_length) {
+            persist_read_data(page_key(store, page), entry->data, PAGED_STORE_PAGE_SIZE);
+        }
+    }
+
+    entry->last_used = ++store->use_clock;
+    entry->dirty |= for_write;
+    return entry->data;
+}
+
+// Forgets cached pages that are no longer part of the store
+static void drop_pages_before(PagedStore *store, uint32_t page) {
+    for (uint8_t i = 0; i < PAGED_STORE_CACHE_PAGES; i++) {
+        PagedStoreCacheEntry *entry = &store->cache[i];
+        if (entry->data && entry->page < page) {
+            free(entry->data);
+            entry->data = NULL;
+            entry->dirty = false;
+        }
+    }
+}
+
+void paged_store_init(PagedStore *store, uint32_t meta_key, uint8_t max_pages) {
+    memset(store, 0, sizeof(PagedStore));
+
+    // Stay within the share of the persist quota that is still free
+    if (max_pages > PAGED_STORE_QUOTA_PAGES - pages_reserved) {
+        APP_LOG(APP_LOG_LEVEL_WARNING, "Paged store %u limited to %u pages", (unsigned)meta_key,
+            PAGED_STORE_QUOTA_PAGES - pages_reserved);
+        max_pages = PAGED_STORE_QUOTA_PAGES - pages_reserved;
+    }
+    pages_reserved += max_pages;
+    store->meta_key = meta_key;
+    store->max_pages = max_pages;
+
+    PagedStoreMeta meta;
+    if (persist_read_data(meta_key, &meta, sizeof(meta)) == sizeof(meta)) {
+        if (meta.max_pages == max_pages) {
+            store->start = meta.start;
+            store->length = meta.length;
+        } else {
+            // The pages were laid out for a different size, start over
+            for (uint8_t i = 0; i < meta.max_pages; i++) {
+                persist_delete(meta_key + 1 + i);
+            }
+            store->meta_dirty = true;
+        }
+    }
+}
+
+void paged_store_deinit(PagedStore *store) {
+    paged_store_flush(store);
+    drop_pages_before(store, UINT32_MAX);
+    pages_reserved -= store->max_pages;
+    store->max_pages = 0;
+}
+
+void paged_store_flush(PagedStore *store) {
+    for (uint8_t i = 0; i < PAGED_STORE_CACHE_PAGES; i++) {
+        write_back(store, &store->cache[i]);
+    }
+
+    if (store->meta_dirty) {
+        PagedStoreMeta meta = {
+            .max_pages = store->max_pages,
+            .start = store->start,
+            .length = store->length,
+        };
+        persist_write_data(store->meta_key, &meta, sizeof(meta));
+        store->meta_dirty = false;
+    }
+}
+
+void paged_store_clear(PagedStore *store) {
+    drop_pages_before(store, UINT32_MAX);
+    for (uint8_t i = 0; i < store->max_pages; i++) {
+        persist_delete(store->meta_key + 1 + i);
+    }
+    store->start = 0;
+    store->length = 0;
+    store->meta_dirty = true;
+}
+
+// Releases everything before offset, e.g. once a log has been compacted. Pages
+// that are entirely before offset no longer count against the store's size.
+void paged_store_discard_before(PagedStore *store, uint32_t offset) {
+    if (offset <= store->start) {
+        return;
+    }
+    if (offset > store->length) {
+        offset = store->length;
+    }
+    store->start = offset;
+    store->meta_dirty = true;
+    drop_pages_before(store, first_page(store));
+}
+
+uint32_t paged_store_start(const PagedStore *store) {
+    return store->start;
+}
+
+uint32_t paged_store_length(const PagedStore *store) {
+    return store->length;
+}
+
+uint32_t paged_store_capacity(const PagedStore *store) {
+    return (uint32_t)store->max_pages * PAGED_STORE_PAGE_SIZE;
+}
+
+// Reads up to size bytes at offset, returning how many were available
+uint16_t paged_store_read(PagedStore *store, uint32_t offset, void *buffer, uint16_t size) {
+    if (offset < store->start || offset >= store->length) {
+        return 0;
+    }
+    if (size > store->length - offset) {
+        size = store->length - offset;
+    }
+
+    uint16_t done = 0;
+    while (done < size) {
+        uint32_t position = offset + done;
+        uint16_t in_page = position % PAGED_STORE_PAGE_SIZE;
+        uint16_t chunk = PAGED_STORE_PAGE_SIZE - in_page;
+        if (chunk > size - done) chunk = size - done;
+
+        uint8_t *page = get_page(store, position / PAGED_STORE_PAGE_SIZE, store->length, false);
+        if (!page) {
+            break;
+        }
+        memcpy((uint8_t*)buffer + done, page + in_page, chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+// Writes size bytes at offset, growing the store (and evicting its oldest
+// pages if it runs out of room) when writing past the end. Returns how many
+// bytes were written, which is less than size if part of the range had
+// already been evicted.
+uint16_t paged_store_write(PagedStore *store, uint32_t offset, const void *data, uint16_t size) {
+    if (size == 0 || store->max_pages == 0) {
+        return 0;
+    }
+
+    uint32_t end = offset + size;
+    uint32_t old_length = store->length;
+    if (end > store->length) {
+        uint32_t last_page = (end - 1) / PAGED_STORE_PAGE_SIZE;
+        uint32_t old_pages = (store->length + PAGED_STORE_PAGE_SIZE - 1) / PAGED_STORE_PAGE_SIZE;
+
+        // Make room by evicting the oldest pages
+        if (last_page >= first_page(store) + store->max_pages) {
+            uint32_t new_first_page = last_page - store->max_pages + 1;
+            store->start = new_first_page * PAGED_STORE_PAGE_SIZE;
+            drop_pages_before(store, new_first_page);
+        }
+
+        // Skipped pages are never written from the cache, so make sure their
+        // keys don't still hold whatever page used the slot before
+        uint32_t written_page = offset / PAGED_STORE_PAGE_SIZE;
+        for (uint32_t page = old_pages; page < written_page; page++) {
+            if (page >= first_page(store)) {
+                persist_delete(page_key(store, page));
+            }
+        }
+
+        store->length = end;
+        store->meta_dirty = true;
+    }
+
+    // Skip the part that was already evicted
+    uint16_t skipped = 0;
+    if (offset < store->start) {
+        if (end <= store->start) {
+            return 0;
+        }
+        skipped = store->start - offset;
+    }
+
+    uint16_t done = skipped;
+    while (done < size) {
+        uint32_t position = offset + done;
+        uint16_t in_page = position % PAGED_STORE_PAGE_SIZE;
+        uint16_t chunk = PAGED_STORE_PAGE_SIZE - in_page;
+        if (chunk > size - done) chunk = size - done;
+
+        uint8_t *page = get_page(store, position / PAGED_STORE_PAGE_SIZE, old_length, true);
+        if (!page) {
+            break;
+        }
+        memcpy(page + in_page, (const uint8_t*)data + done, chunk);
+        done += chunk;
+    }
+    return done - skipped;
+}
@@ -0,0 +1,53 @@
+/*
+  Paged persistent storage.
+
+  Maps a growing logical byte array onto a range of persist keys so that data
+  can grow past the 256 byte limit of a single persisted value. The store's
+  metadata lives in meta_key and its pages in the max_pages keys right after
+  it. Once the array outgrows max_pages, the oldest pages are evicted to make
+  room, so a store never takes more than its share of the app's persist quota.
+
+  Pages are cached in RAM while in use and only pages that were written are
+  persisted again by paged_store_flush().
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+// Pebble caps a single persisted value at this many bytes
+#define PAGED_STORE_PAGE_SIZE PERSIST_DATA_MAX_LENGTH
+// Pages that all stores together may occupy. The app gets 4 KB of persistent
+// storage, part of which is left for the state snapshot and store metadata.
+#define PAGED_STORE_QUOTA_PAGES 14
+// Pages of each store that are kept in RAM at the same time
+#define PAGED_STORE_CACHE_PAGES 2
+
+typedef struct {
+    uint32_t page;
+    uint8_t *data;
+    uint16_t last_used;
+    bool dirty;
+} PagedStoreCacheEntry;
+
+typedef struct {
+    uint32_t meta_key;
+    uint8_t max_pages;
+    // Offset of the oldest byte still stored
+    uint32_t start;
+    // Offset one past the newest byte written
+    uint32_t length;
+    bool meta_dirty;
+    uint16_t use_clock;
+    PagedStoreCacheEntry cache[PAGED_STORE_CACHE_PAGES];
+} PagedStore;
+
+void paged_store_init(PagedStore *store, uint32_t meta_key, uint8_t max_pages);
+void paged_store_deinit(PagedStore *store);
+void paged_store_flush(PagedStore *store);
+void paged_store_clear(PagedStore *store);
+void paged_store_discard_before(PagedStore *store, uint32_t offset);
+uint32_t paged_store_start(const PagedStore *store);
+uint32_t paged_store_length(const PagedStore *store);
+uint32_t paged_store_capacity(const PagedStore *store);
+uint16_t paged_store_read(PagedStore *store, uint32_t offset, void *buffer, uint16_t size);
+uint16_t paged_store_write(PagedStore *store, uint32_t offset, const void *data, uint16_t size);
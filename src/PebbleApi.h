@@ -0,0 +1,15 @@
+/*
+  The SDK header for modules shared with the background worker.
+
+  The worker is built against pebble_worker.h, which can't be mixed with
+  pebble.h. The wscript defines PEBBLE_WORKER for the worker build, so the
+  modules in WORKER_SHARED_SOURCES, and the headers they include, include
+  this instead of either SDK header.
+*/
+
+#pragma once
+#ifdef PEBBLE_WORKER
+#include <pebble_worker.h>
+#else
+#include <pebble.h>
+#endif
@@ -0,0 +1,68 @@
+#include <pebble.h>
+#include "ReminderPlan.h"
+#include "IntakeProfile.h"
+#include "WakeupPlanner.h"
+
+#define SECONDS_IN_HOUR 3600
+
+// Up to count reminders, each hours after the one before. The first reminder
+// is always kept, the rest have to be before day->last. A snoozed reminder
+// comes back when it was asked to.
+uint8_t reminder_plan_spaced(const ReminderDay *day, float hours, uint8_t count, time_t *times, uint8_t max) {
+    if (hours < 0.5) hours = 0.5;
+    hours *= day->backoff;
+    if (count > max) count = max;
+
+    time_t reminder_time = day->now;
+    if (day->snoozed_until > reminder_time) {
+        reminder_time = day->snoozed_until - hours * SECONDS_IN_HOUR;
+    }
+    uint8_t planned = 0;
+    while (planned < count) {
+        reminder_time = wakeup_planner_next_allowed(reminder_time + hours * SECONDS_IN_HOUR);
+        if (planned > 0 && reminder_time > day->last) {
+            break;
+        }
+        times[planned++] = reminder_time;
+    }
+    return planned;
+}
+
+// A reminder goes off when the user's usual pace gets a whole unit ahead of
+// what has been drunk, assuming each reminder is followed by one unit.
+// Keeping up with the usual pace means no reminders.
+uint8_t reminder_plan_paced(const ReminderDay *day, float units_done, float units_goal, time_t *times, uint8_t max) {
+    time_t gap = REMINDER_PLAN_MIN_GAP * day->backoff;
+    time_t earliest = day->now + gap;
+
+    uint8_t planned = 0;
+    if (max > 0 && day->snoozed_until > day->now) {
+        times[planned++] = wakeup_planner_next_allowed(day->snoozed_until);
+        earliest = times[0] + gap;
+    }
+    for (uint8_t k = 1; planned < max && units_done + k - 1 < units_goal; k++) {
+        float fraction = (units_done + k) / units_goal;
+        if (fraction > 1) fraction = 1;
+        time_t reminder_time = day->day_start + intake_profile_minute_for(fraction * INTAKE_PROFILE_ONE) * 60;
+        if (reminder_time < earliest) reminder_time = earliest;
+        reminder_time = wakeup_planner_next_allowed(reminder_time);
+        if (reminder_time > day->last) {
+            break;
+        }
+        times[planned++] = reminder_time;
+        earliest = reminder_time + gap;
+    }
+    return planned;
+}
+
+// Whether what's been drunk plus what the usual pace drinks in the rest of the
+// day clears the goal by REMINDER_PLAN_PACE_MARGIN. Paced reminders only keep
+// the user to their usual pace, so if that falls short the spaced ones are
+// used instead.
+bool reminder_plan_on_pace(const ReminderDay *day, float units_done, float units_goal, uint32_t goal_ml) {
+    time_t minute = (day->now - day->day_start) / 60;
+    if (minute < 0) minute = 0;
+    if (minute > INTAKE_PROFILE_HOURS * 60) minute = INTAKE_PROFILE_HOURS * 60;
+    float projected = units_done / units_goal + (float)intake_profile_ml_after(minute) / goal_ml;
+    return projected >= REMINDER_PLAN_PACE_MARGIN;
+}
@@ -0,0 +1,37 @@
+/*
+  Reminder timetables.
+
+  Works out when the rest of the day's reminders should go off. The app only
+  schedules the first of them, see REMINDER_SLOTS. Reminders are either
+  spaced a fixed number of hours apart or paced by the learned intake
+  profile, see IntakeProfile.h. Paced reminders are only used while the
+  usual pace would meet the goal, see reminder_plan_on_pace(). Both are moved out of the planner's quiet
+  hours. The caller describes the day in a ReminderDay, so nothing here
+  depends on the app's state or UI.
+*/
+
+#pragma once
+#include <pebble.h>
+
+// Shortest gap between two paced reminders
+#define REMINDER_PLAN_MIN_GAP (30 * 60)
+// The usual pace has to project this much of the goal before paced reminders
+// are used. The profile includes drinks that reminders asked for and usual
+// drinks that get skipped, so it runs ahead of a day without reminders.
+#define REMINDER_PLAN_PACE_MARGIN 1.25f
+
+typedef struct {
+    // All times are UTC
+    time_t now;
+    time_t day_start;
+    // No reminder after this one but the first, two hours before the day ends
+    time_t last;
+    // A snoozed reminder comes back at this time, if it's still ahead
+    time_t snoozed_until;
+    // Multiplies the time between reminders
+    uint8_t backoff;
+} ReminderDay;
+
+uint8_t reminder_plan_spaced(const ReminderDay *day, float hours, uint8_t count, time_t *times, uint8_t max);
+uint8_t reminder_plan_paced(const ReminderDay *day, float units_done, float units_goal, time_t *times, uint8_t max);
+bool reminder_plan_on_pace(const ReminderDay *day, float units_done, float units_goal, uint32_t goal_ml);
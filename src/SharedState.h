@@ -0,0 +1,95 @@
+/*
+  State shared between the app and the background worker.
+
+  Both sides read and write the same STATE_KEY snapshot, so its layout, the
+  units its volumes are counted in and the messages used to take turns with
+  it live here rather than in GallonChallenge.h, which is private to the app.
+  The worker only touches the snapshot while the app is closed, see
+  worker_src/GallonWorker.c.
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+#define STATE_KEY 1016
+#define STATE_VERSION 4
+
+#define OZ_IN_CUP 8
+#define OZ_IN_PINT 16
+#define OZ_IN_QUART 32
+#define OZ_IN_GAL 128
+#define EXACT_ML_IN_OZ 29.5735
+#define ML_IN_OZ 50 // approx
+#define ML_IN_CUP 250 // approx
+#define ML_IN_PINT 500 // approx
+#define ML_IN_QUART 1000 // approx
+#define ML_IN_GAL 4000 // approx
+#define CUP_IN_GAL 16
+#define PINT_IN_GAL 8
+#define QUART_IN_GAL 4
+#define ML_IN_L 1000
+
+#define SEC_IN_HOUR 3600
+#define SEC_IN_DAY 86400
+
+typedef enum {
+    OUNCE,
+    CUP,
+    PINT,
+    QUART,
+    HALF_GALLON,
+    GALLON,
+    CUSTOM
+} Unit;
+
+typedef enum {
+    CUSTOMARY,
+    METRIC
+} UnitSystem;
+
+// Everything that is saved between launches, written with one persist call.
+// Fields are only ever appended, bumping STATE_VERSION, so that snapshots
+// from older versions can still be read with the new fields defaulted.
+typedef struct __attribute__((__packed__)) {
+    uint8_t version;
+    uint8_t unit_system;
+    uint8_t goal;
+    uint8_t unit;
+    uint8_t current_oz;
+    uint8_t start_of_day;
+    uint8_t end_of_day;
+    uint8_t inactivity_reminder_hours;
+    uint8_t cdu_oz;
+    uint16_t current_ml;
+    uint16_t cdu_ml;
+    uint16_t streak_count;
+    uint16_t longest_streak;
+    // Only read from version 1 snapshots, where it could overflow
+    uint16_t total_consumed_v1;
+    int32_t current_date;
+    int32_t last_streak_date;
+    int32_t drinking_since;
+    // Added in version 2
+    uint32_t total_consumed;
+    // Added in version 3
+    uint32_t total_drinks;
+    uint16_t days_logged;
+    // Added in version 4
+    uint8_t ignored_reminders;
+    int32_t snoozed_until;
+    uint16_t reminders_shown;
+    uint16_t reminders_vibrated;
+    uint16_t reminders_answered;
+} PersistedState;
+
+#define STATE_V1_SIZE offsetof(PersistedState, total_consumed)
+
+// Message types sent with app_worker_send_message()
+typedef enum {
+    // App to worker: leave the snapshot alone until the app is closed
+    WORKER_MSG_APP_OPENED = 1,
+    // App to worker: the snapshot is saved and may have changed
+    WORKER_MSG_APP_CLOSED,
+    // Worker to app: the worker just started and assumes the app is closed
+    WORKER_MSG_STARTED,
+} WorkerMessage;
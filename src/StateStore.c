@@ -0,0 +1,92 @@
+#include <pebble.h>
+#include "StateStore.h"
+
+// The per-field keys that came before STATE_KEY, only read to migrate them.
+// Key for saving the previous date that the user completed the day's challenge
+// to determine if the streak count needs to be reset. Saved as a time_t.
+#define LAST_STREAK_DATE_KEY 1000
+// Key for saving streak count
+#define STREAK_COUNT_KEY 1001
+// Keys for saving current day's water volume intake
+#define CURRENT_DATE_KEY 1002
+#define CURRENT_OZ_KEY 1003
+#define CURRENT_ML_KEY 1013
+// Key for saving display unit type
+#define UNIT_KEY 1004
+// Key for saving the type of unit system
+#define UNIT_SYSTEM_KEY 1011
+// Keys for saving the custom drinking unit in oz/ml
+#define CDU_OZ_KEY 1014
+#define CDU_ML_KEY 1015
+// Key for saving goal unit type
+#define GOAL_KEY 1005
+// Key for saving end of day
+#define EOD_KEY 1006
+// Key for saving start of day
+#define SOD_KEY 1012
+// Keys for saving profile info
+#define TOTAL_CONSUMED_KEY 1007
+#define LONGEST_STREAK_KEY 1008
+#define DRINKING_SINCE_KEY 1009
+// Key for saving the number of hours for inactivity reminder
+#define REMINDER_KEY 1010
+
+static int32_t read_legacy(uint32_t key, int32_t default_value) {
+    return persist_exists(key) ? persist_read_int(key) : default_value;
+}
+
+static void load_legacy(PersistedState *state, time_t now) {
+    memset(state, 0, sizeof(PersistedState));
+    state->version = STATE_VERSION;
+    state->current_oz = read_legacy(CURRENT_OZ_KEY, 0);
+    state->current_ml = read_legacy(CURRENT_ML_KEY, 0);
+    state->start_of_day = read_legacy(SOD_KEY, 9);
+    state->end_of_day = read_legacy(EOD_KEY, 0);
+    state->inactivity_reminder_hours = read_legacy(REMINDER_KEY, 1);
+    state->unit_system = read_legacy(UNIT_SYSTEM_KEY, CUSTOMARY);
+    state->goal = read_legacy(GOAL_KEY, GALLON);
+    state->unit = read_legacy(UNIT_KEY, CUP);
+    state->streak_count = read_legacy(STREAK_COUNT_KEY, 0);
+    time_t today = now - state->end_of_day * SEC_IN_HOUR;
+    state->last_streak_date = read_legacy(LAST_STREAK_DATE_KEY, today - SEC_IN_DAY);
+    state->current_date = read_legacy(CURRENT_DATE_KEY, today);
+    state->total_consumed = read_legacy(TOTAL_CONSUMED_KEY, 0);
+    state->total_consumed_v1 = state->total_consumed;
+    state->longest_streak = read_legacy(LONGEST_STREAK_KEY, 0);
+    state->cdu_oz = read_legacy(CDU_OZ_KEY, 8);
+    state->cdu_ml = read_legacy(CDU_ML_KEY, 250);
+    state->drinking_since = read_legacy(DRINKING_SINCE_KEY, now);
+}
+
+static void delete_legacy() {
+    const uint32_t legacy_keys[] = {
+        CURRENT_OZ_KEY, CURRENT_ML_KEY, SOD_KEY, EOD_KEY, REMINDER_KEY, UNIT_SYSTEM_KEY,
+        GOAL_KEY, UNIT_KEY, STREAK_COUNT_KEY, LAST_STREAK_DATE_KEY, CURRENT_DATE_KEY,
+        TOTAL_CONSUMED_KEY, LONGEST_STREAK_KEY, CDU_OZ_KEY, CDU_ML_KEY, DRINKING_SINCE_KEY
+    };
+    for (uint8_t i = 0; i < ARRAY_LENGTH(legacy_keys); i++) {
+        persist_delete(legacy_keys[i]);
+    }
+}
+
+bool state_store_load(PersistedState *state, time_t now) {
+    memset(state, 0, sizeof(PersistedState));
+    int size = persist_read_data(STATE_KEY, state, sizeof(PersistedState));
+    if (size >= (int)STATE_V1_SIZE && state->version != 0) {
+        if (state->version > STATE_VERSION) {
+            state->version = STATE_VERSION;
+        }
+        return true;
+    }
+
+    // First launch since the snapshot format was introduced, so move the old
+    // per-field values (or the defaults) over to it once
+    load_legacy(state, now);
+    state_store_save(state);
+    delete_legacy();
+    return false;
+}
+
+void state_store_save(const PersistedState *state) {
+    persist_write_data(STATE_KEY, state, sizeof(PersistedState));
+}
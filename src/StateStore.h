@@ -0,0 +1,22 @@
+/*
+  Loading and saving the STATE_KEY snapshot.
+
+  Installs from before the snapshot kept one persist key per field. The
+  first load after updating moves those values (or the defaults for the
+  ones that were never saved) into a snapshot and deletes the old keys.
+
+  Fields are only ever appended to PersistedState, so a snapshot saved by a
+  newer version starts with every field this version knows. It is read as
+  far as that and treated as the current version, so going back to an older
+  version keeps the settings, streaks and totals. Saving it again drops only
+  the fields the older version doesn't know.
+*/
+
+#pragma once
+#include <pebble.h>
+#include "SharedState.h"
+
+// now is the local time, used for the defaults of a fresh install. Returns
+// false if the state had to be migrated from the per-field keys.
+bool state_store_load(PersistedState *state, time_t now);
+void state_store_save(const PersistedState *state);
@@ -0,0 +1,142 @@
+#include "PebbleApi.h"
+#include "Streaks.h"
+#include "PagedStore.h"
+
+#define DAYS_IN_WORD 32
+
+static PagedStore store;
+
+static uint32_t read_word(uint32_t index) {
+    uint32_t word = 0;
+    paged_store_read(&store, index * sizeof(word), &word, sizeof(word));
+    return word;
+}
+
+// Bits of the word at index that belong to days in [first_day, end_day)
+static uint32_t read_word_in_range(uint32_t index, uint32_t first_day, uint32_t end_day) {
+    uint32_t word = read_word(index);
+    uint32_t word_first_day = index * DAYS_IN_WORD;
+    if (first_day > word_first_day) {
+        word &= UINT32_MAX << (first_day - word_first_day);
+    }
+    if (end_day < word_first_day + DAYS_IN_WORD) {
+        word &= ~(UINT32_MAX << (end_day - word_first_day));
+    }
+    return word;
+}
+
+static uint8_t longest_run_in_word(uint32_t word) {
+    uint8_t run = 0;
+    while (word) {
+        word &= word << 1;
+        run++;
+    }
+    return run;
+}
+
+static uint32_t first_stored_day() {
+    return paged_store_start(&store) / sizeof(uint32_t) * DAYS_IN_WORD;
+}
+
+void streaks_init() {
+    paged_store_init(&store, STREAKS_KEY, STREAKS_PAGES);
+}
+
+void streaks_deinit() {
+    paged_store_deinit(&store);
+}
+
+void streaks_flush() {
+    paged_store_flush(&store);
+}
+
+bool streaks_is_empty() {
+    return paged_store_length(&store) == 0;
+}
+
+void streaks_set_goal_met(uint32_t day, bool met) {
+    uint32_t index = day / DAYS_IN_WORD;
+    uint32_t bit = 1u << (day % DAYS_IN_WORD);
+    uint32_t word = read_word(index);
+    uint32_t updated = met ? (word | bit) : (word & ~bit);
+    if (updated != word) {
+        paged_store_write(&store, index * sizeof(updated), &updated, sizeof(updated));
+    }
+}
+
+bool streaks_goal_met(uint32_t day) {
+    return read_word(day / DAYS_IN_WORD) & (1u << (day % DAYS_IN_WORD));
+}
+
+// Number of consecutive days up to and including day where the goal was met
+uint16_t streaks_run_ending(uint32_t day) {
+    uint32_t first_index = first_stored_day() / DAYS_IN_WORD;
+    uint32_t index = day / DAYS_IN_WORD;
+    uint8_t position = day % DAYS_IN_WORD;
+    uint16_t run = 0;
+
+    while (true) {
+        // Move day to the top bit so the run is the number of leading ones
+        uint32_t not_met = ~(read_word(index) << (DAYS_IN_WORD - 1 - position));
+        uint8_t ones = not_met ? __builtin_clz(not_met) : DAYS_IN_WORD;
+        run += ones;
+        if (ones <= position || index == 0 || index <= first_index) {
+            return run;
+        }
+        index--;
+        position = DAYS_IN_WORD - 1;
+    }
+}
+
+// The streak still going today. Today only counts once its goal is met, but
+// not having met it yet doesn't break the streak.
+uint16_t streaks_current(uint32_t today) {
+    return streaks_goal_met(today) ? streaks_run_ending(today) : streaks_run_ending(today - 1);
+}
+
+// Longest run of met goals among the days in [first_day, end_day)
+uint16_t streaks_longest(uint32_t first_day, uint32_t end_day) {
+    if (first_day < first_stored_day()) {
+        first_day = first_stored_day();
+    }
+    if (first_day >= end_day) {
+        return 0;
+    }
+
+    uint16_t longest = 0;
+    uint16_t run = 0;
+    for (uint32_t index = first_day / DAYS_IN_WORD; index <= (end_day - 1) / DAYS_IN_WORD; index++) {
+        uint32_t word = read_word_in_range(index, first_day, end_day);
+        if (word == UINT32_MAX) {
+            run += DAYS_IN_WORD;
+            continue;
+        }
+
+        // The run carried over from older days continues through the low bits
+        run += __builtin_ctz(~word);
+        if (run > longest) longest = run;
+
+        uint8_t inner = longest_run_in_word(word);
+        if (inner > longest) longest = inner;
+
+        // and the high bits start the run carried into the next word
+        run = __builtin_clz(~word);
+    }
+    return (run > longest) ? run : longest;
+}
+
+// Number of days in [first_day, end_day) where the goal was met
+uint16_t streaks_goals_met(uint32_t first_day, uint32_t end_day) {
+    if (first_day < first_stored_day()) {
+        first_day = first_stored_day();
+    }
+    if (first_day >= end_day) {
+        return 0;
+    }
+
+    uint16_t count = 0;
+    for (uint32_t index = first_day / DAYS_IN_WORD; index <= (end_day - 1) / DAYS_IN_WORD; index++) {
+        count += __builtin_popcount(read_word_in_range(index, first_day, end_day));
+    }
+    return count;
+}
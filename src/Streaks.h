@@ -0,0 +1,27 @@
+/*
+  Goal-met bitmap.
+
+  One bit per day number records whether that day's goal was met, stored as
+  32-day words in a paged store. Streaks and completion rates are derived
+  from the bitmap a word at a time with count-leading/trailing-zeros and
+  popcount, so they stay correct even when an earlier day changes.
+
+  STREAKS_PAGES pages cover STREAKS_PAGES * 2048 days (over 11 years).
+*/
+
+#pragma once
+#include "PebbleApi.h"
+
+#define STREAKS_KEY 3010
+#define STREAKS_PAGES 2
+
+void streaks_init();
+void streaks_deinit();
+void streaks_flush();
+bool streaks_is_empty();
+void streaks_set_goal_met(uint32_t day, bool met);
+bool streaks_goal_met(uint32_t day);
+uint16_t streaks_run_ending(uint32_t day);
+uint16_t streaks_current(uint32_t today);
+uint16_t streaks_longest(uint32_t first_day, uint32_t end_day);
+uint16_t streaks_goals_met(uint32_t first_day, uint32_t end_day);
@@ -0,0 +1,223 @@
+#include <pebble.h>
+#include "WakeupPlanner.h"
+#include "DayClock.h"
+
+#define SECONDS_IN_HOUR 3600
+#define SECONDS_IN_DAY 86400
+
+static PlannedWakeup planned[WAKEUP_PLANNER_SLOTS];
+static uint8_t planned_count;
+static time_t blocked[WAKEUP_PLANNER_BLOCKED];
+static uint8_t blocked_next;
+static uint16_t schedules, attempts;
+// Bit n set means no wakeups should go off in local hour n
+static uint32_t quiet_hours;
+
+static void save() {
+    if (planned_count == 0) {
+        persist_delete(WAKEUP_PLAN_KEY);
+    } else {
+        persist_write_data(WAKEUP_PLAN_KEY, planned, planned_count * sizeof(PlannedWakeup));
+    }
+}
+
+static void remove_at(uint8_t index) {
+    planned[index] = planned[--planned_count];
+}
+
+static int8_t index_of(WakeupId id) {
+    for (uint8_t i = 0; i < planned_count; i++) {
+        if (planned[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool conflicts(time_t a, time_t b) {
+    return b != 0 && a > b - WAKEUP_PLANNER_SPACING && a < b + WAKEUP_PLANNER_SPACING;
+}
+
+// Moves time past every known wakeup it's too close to. Each move is past the
+// wakeup found, so a few passes over the table settle on a free time.
+static time_t first_free_time(time_t time) {
+    bool moved = true;
+    for (uint8_t pass = 0; moved && pass <= WAKEUP_PLANNER_SLOTS + WAKEUP_PLANNER_BLOCKED; pass++) {
+        moved = false;
+        for (uint8_t i = 0; i < planned_count; i++) {
+            if (conflicts(time, planned[i].time)) {
+                time = planned[i].time + WAKEUP_PLANNER_SPACING;
+                moved = true;
+            }
+        }
+        for (uint8_t i = 0; i < WAKEUP_PLANNER_BLOCKED; i++) {
+            if (conflicts(time, blocked[i])) {
+                time = blocked[i] + WAKEUP_PLANNER_SPACING;
+                moved = true;
+            }
+        }
+    }
+    return time;
+}
+
+// Loads the table, dropping wakeups that already fired or were cancelled
+void wakeup_planner_init() {
+    int size = persist_read_data(WAKEUP_PLAN_KEY, planned, sizeof(planned));
+    planned_count = (size > 0) ? size / sizeof(PlannedWakeup) : 0;
+
+    uint8_t before = planned_count;
+    for (uint8_t i = planned_count; i > 0; i--) {
+        if (!wakeup_query(planned[i - 1].id, NULL)) {
+            remove_at(i - 1);
+        }
+    }
+    if (planned_count != before) {
+        save();
+    }
+}
+
+// Takes over a wakeup that was scheduled without the planner, e.g. by an
+// older version of the app
+void wakeup_planner_adopt(WakeupId id, int32_t reason) {
+    time_t time;
+    if (planned_count < WAKEUP_PLANNER_SLOTS && index_of(id) < 0 && wakeup_query(id, &time)) {
+        planned[planned_count++] = (PlannedWakeup) { .id = id, .time = time, .reason = reason };
+        save();
+    }
+}
+
+// Schedules a wakeup at the first free minute from time, returning its id or
+// a negative StatusCode
+WakeupId wakeup_planner_schedule(time_t time, int32_t reason, bool notify_if_missed) {
+    if (planned_count >= WAKEUP_PLANNER_SLOTS) {
+        return E_OUT_OF_RESOURCES;
+    }
+    schedules++;
+
+    WakeupId id = E_RANGE;
+    for (uint8_t attempt = 0; attempt < WAKEUP_PLANNER_MAX_ATTEMPTS; attempt++) {
+        time = first_free_time(time);
+        id = wakeup_schedule(time, reason, notify_if_missed);
+        attempts++;
+        if (id >= 0) {
+            planned[planned_count++] = (PlannedWakeup) { .id = id, .time = time, .reason = reason };
+            save();
+            return id;
+        }
+        if (id == E_RANGE) {
+            // Another app has a wakeup around then, remember to avoid it
+            blocked[blocked_next] = time;
+            blocked_next = (blocked_next + 1) % WAKEUP_PLANNER_BLOCKED;
+        } else if (id != E_INTERNAL) {
+            break;
+        }
+    }
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Couldn't schedule wakeup %d: %d", (int)reason, (int)id);
+    return id;
+}
+
+void wakeup_planner_cancel(WakeupId id) {
+    int8_t index = index_of(id);
+    if (index >= 0) {
+        wakeup_cancel(id);
+        remove_at(index);
+        save();
+    }
+}
+
+void wakeup_planner_cancel_all() {
+    wakeup_cancel_all();
+    planned_count = 0;
+    save();
+}
+
+// Makes the wakeups for reason match times, keeping the ones that are already
+// within tolerance of a wanted time and only cancelling or scheduling the rest
+void wakeup_planner_sync(int32_t reason, const time_t *times, uint8_t count, time_t tolerance, bool notify_if_missed) {
+    bool kept[WAKEUP_PLANNER_SLOTS] = { false };
+    bool changed = false;
+    if (count > WAKEUP_PLANNER_SLOTS) count = WAKEUP_PLANNER_SLOTS;
+
+    for (uint8_t i = planned_count; i > 0; i--) {
+        PlannedWakeup *wakeup = &planned[i - 1];
+        if (wakeup->reason != reason) {
+            continue;
+        }
+        int8_t match = -1;
+        for (uint8_t j = 0; j < count && match < 0; j++) {
+            if (!kept[j] && wakeup->time >= times[j] - tolerance && wakeup->time <= times[j] + tolerance) {
+                match = j;
+            }
+        }
+        if (match >= 0) {
+            kept[match] = true;
+        } else {
+            wakeup_cancel(wakeup->id);
+            remove_at(i - 1);
+            changed = true;
+        }
+    }
+    if (changed) {
+        save();
+    }
+
+    for (uint8_t j = 0; j < count; j++) {
+        if (!kept[j]) {
+            wakeup_planner_schedule(times[j], reason, notify_if_missed);
+        }
+    }
+}
+
+// Drops a wakeup that has fired
+void wakeup_planner_forget(WakeupId id) {
+    int8_t index = index_of(id);
+    if (index >= 0) {
+        remove_at(index);
+        save();
+    }
+}
+
+// Finds the earliest wakeup scheduled for reason, time may be NULL
+bool wakeup_planner_find(int32_t reason, time_t *time) {
+    int8_t earliest = -1;
+    for (uint8_t i = 0; i < planned_count; i++) {
+        if (planned[i].reason == reason && (earliest < 0 || planned[i].time < planned[earliest].time)) {
+            earliest = i;
+        }
+    }
+    if (earliest >= 0 && time) {
+        *time = planned[earliest].time;
+    }
+    return earliest >= 0;
+}
+
+void wakeup_planner_set_quiet_hours(uint32_t hours) {
+    quiet_hours = hours & WAKEUP_PLANNER_ALL_HOURS;
+}
+
+bool wakeup_planner_is_quiet(time_t time) {
+    time_t local = time + day_clock_utc_offset();
+    return quiet_hours & (1 << (local % SECONDS_IN_DAY / SECONDS_IN_HOUR));
+}
+
+// Pushes a UTC time that falls in the quiet hours to the first minute after
+// them, so the watch isn't woken up for a reminder that would stay silent
+time_t wakeup_planner_next_allowed(time_t time) {
+    if (quiet_hours == WAKEUP_PLANNER_ALL_HOURS) {
+        return time;
+    }
+    while (wakeup_planner_is_quiet(time)) {
+        time_t local = time + day_clock_utc_offset();
+        time += SECONDS_IN_HOUR - local % SECONDS_IN_HOUR;
+    }
+    return time;
+}
+
+// Wakeups requested and wakeup_schedule() calls made for them, for debugging
+uint16_t wakeup_planner_schedules() {
+    return schedules;
+}
+
+uint16_t wakeup_planner_attempts() {
+    return attempts;
+}
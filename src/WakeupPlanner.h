@@ -0,0 +1,49 @@
+/*
+  Bookkeeping for the app's wakeup events.
+
+  Pebble refuses to schedule a wakeup within a minute of any other wakeup on
+  the watch (E_RANGE) and allows each app a limited number of them. The
+  planner keeps the app's own wakeups in a table persisted in
+  WAKEUP_PLAN_KEY. While the app runs it also remembers the last few times
+  other apps turned out to be using, in RAM only. So a free minute is
+  usually found in memory and only needs a single wakeup_schedule() call. If
+  the watch still reports a conflict, the event moves a minute later, at
+  most WAKEUP_PLANNER_MAX_ATTEMPTS times.
+
+  The planner also keeps the quiet hours, a mask of local hours in which
+  reminders would be silent, so callers can move reminders out of them
+  instead of waking the watch for nothing.
+*/
+
+#pragma once
+#include <pebble.h>
+
+#define WAKEUP_PLAN_KEY 2004
+// Pebble allows an app this many wakeups at once
+#define WAKEUP_PLANNER_SLOTS 8
+#define WAKEUP_PLANNER_MAX_ATTEMPTS 3
+// Minutes taken by other apps that are remembered while the app runs
+#define WAKEUP_PLANNER_BLOCKED 4
+// Wakeups closer together than this are rejected by the system
+#define WAKEUP_PLANNER_SPACING 60
+#define WAKEUP_PLANNER_ALL_HOURS 0xFFFFFF
+
+typedef struct __attribute__((__packed__)) {
+    int32_t id;
+    int32_t time;
+    int32_t reason;
+} PlannedWakeup;
+
+void wakeup_planner_init();
+void wakeup_planner_adopt(WakeupId id, int32_t reason);
+WakeupId wakeup_planner_schedule(time_t time, int32_t reason, bool notify_if_missed);
+void wakeup_planner_cancel(WakeupId id);
+void wakeup_planner_cancel_all();
+void wakeup_planner_sync(int32_t reason, const time_t *times, uint8_t count, time_t tolerance, bool notify_if_missed);
+void wakeup_planner_forget(WakeupId id);
+bool wakeup_planner_find(int32_t reason, time_t *time);
+void wakeup_planner_set_quiet_hours(uint32_t hours);
+bool wakeup_planner_is_quiet(time_t time);
+time_t wakeup_planner_next_allowed(time_t time);
+uint16_t wakeup_planner_schedules();
+uint16_t wakeup_planner_attempts();
@@ -0,0 +1,59 @@
+/*
+  This code is derived from PDPCLIB, the public domain C runtime
+  library by Paul Edwards. http://pdos.sourceforge.net/
+
+  This code is released to the public domain.
+*/
+
+/*
+  p_mktime() as the app used it before CivilDate.h, kept only so that
+  test_civil_date can compare against it. It gives up after 2020.
+*/
+#include <time.h>
+
+/* scalar date routines    --    public domain by Ray Gardner
+** These will work over the range 1-01-01 thru 14699-12-31
+** The functions written by Ray are isleap, months_to_days,
+** years_to_days, ymd_to_scalar, scalar_to_ymd.
+** modified slightly by Paul Edwards
+*/
+
+static int isleap (unsigned yr) {
+  return yr % 400 == 0 || (yr % 4 == 0 && yr % 100 != 0);
+}
+
+static unsigned months_to_days (unsigned month) {
+  return (month * 3057 - 3007) / 100;
+}
+
+static unsigned years_to_days (unsigned yr) {
+  return yr * 365L + yr / 4 - yr / 100 + yr / 400;
+}
+
+static long ymd_to_scalar (unsigned yr, unsigned mo, unsigned day) {
+  long scalar;
+
+  scalar = day + months_to_days(mo);
+  if (mo > 2) /* adjust if past February */
+    scalar -= isleap(yr) ? 1 : 2;
+  yr--;
+  scalar += years_to_days(yr);
+  return scalar;
+}
+
+time_t p_mktime (struct tm *timeptr) {
+  time_t tt;
+
+  if ((timeptr->tm_year < 70) || (timeptr->tm_year > 120)) {
+    tt = (time_t)-1;
+  } else {
+    tt = ymd_to_scalar(timeptr->tm_year + 1900,
+                       timeptr->tm_mon + 1,
+                       timeptr->tm_mday)
+      - ymd_to_scalar(1970, 1, 1);
+    tt = tt * 24 + timeptr->tm_hour;
+    tt = tt * 60 + timeptr->tm_min;
+    tt = tt * 60 + timeptr->tm_sec;
+  }
+  return tt;
+}
@@ -0,0 +1,214 @@
+#define _GNU_SOURCE
+#include <pebble.h>
+#include "fake_pebble.h"
+
+#undef malloc
+#undef free
+
+#define FAKE_KEYS 8192
+#define FAKE_WAKEUPS 64
+// Pebble won't schedule two wakeups within a minute of each other, and an
+// app gets this many
+#define FAKE_WAKEUP_SPACING 60
+#define FAKE_APP_WAKEUPS 8
+
+typedef struct {
+    bool used;
+    uint16_t length;
+    uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} FakeKey;
+
+typedef struct {
+    WakeupId id;
+    time_t timestamp;
+    bool foreign;
+} FakeWakeup;
+
+int fake_log_lines;
+FakePersistCounts fake_persist_counts;
+time_t fake_time_now;
+uint32_t fake_wakeup_syscalls;
+size_t fake_heap_used, fake_heap_peak;
+
+static FakeKey keys[FAKE_KEYS];
+static FakeWakeup wakeups[FAKE_WAKEUPS];
+static uint8_t wakeup_count;
+static WakeupId next_wakeup_id = 1;
+
+// Each block starts with its size, so fake_free() knows how much to take off
+void *fake_malloc(size_t size) {
+    size_t *block = malloc(sizeof(size_t) + size);
+    if (!block) {
+        return NULL;
+    }
+    *block = size;
+    fake_heap_used += size;
+    if (fake_heap_used > fake_heap_peak) fake_heap_peak = fake_heap_used;
+    return block + 1;
+}
+
+void fake_free(void *pointer) {
+    if (!pointer) {
+        return;
+    }
+    size_t *block = (size_t *)pointer - 1;
+    fake_heap_used -= *block;
+    free(block);
+}
+
+void fake_heap_reset_peak(void) {
+    fake_heap_peak = fake_heap_used;
+}
+
+void fake_persist_reset_counts(void) {
+    memset(&fake_persist_counts, 0, sizeof(fake_persist_counts));
+}
+
+void fake_persist_clear(void) {
+    memset(keys, 0, sizeof(keys));
+    fake_persist_reset_counts();
+}
+
+int fake_persist_used_bytes(void) {
+    int total = 0;
+    for (int i = 0; i < FAKE_KEYS; i++) {
+        if (keys[i].used) total += keys[i].length;
+    }
+    return total;
+}
+
+bool persist_exists(uint32_t key) {
+    fake_persist_counts.exists++;
+    return key < FAKE_KEYS && keys[key].used;
+}
+
+int persist_get_size(uint32_t key) {
+    return (key < FAKE_KEYS && keys[key].used) ? keys[key].length : E_DOES_NOT_EXIST;
+}
+
+int persist_read_data(uint32_t key, void *buffer, size_t size) {
+    fake_persist_counts.reads++;
+    if (key >= FAKE_KEYS || !keys[key].used) {
+        return E_DOES_NOT_EXIST;
+    }
+    if (size > keys[key].length) size = keys[key].length;
+    memcpy(buffer, keys[key].data, size);
+    fake_persist_counts.bytes_read += size;
+    return size;
+}
+
+int persist_write_data(uint32_t key, const void *data, size_t size) {
+    fake_persist_counts.writes++;
+    if (key >= FAKE_KEYS) {
+        return E_INVALID_ARGUMENT;
+    }
+    if (size > PERSIST_DATA_MAX_LENGTH) size = PERSIST_DATA_MAX_LENGTH;
+    keys[key].used = true;
+    keys[key].length = size;
+    memcpy(keys[key].data, data, size);
+    fake_persist_counts.bytes_written += size;
+    return size;
+}
+
+int32_t persist_read_int(uint32_t key) {
+    int32_t value = 0;
+    persist_read_data(key, &value, sizeof(value));
+    return value;
+}
+
+status_t persist_write_int(uint32_t key, int32_t value) {
+    return persist_write_data(key, &value, sizeof(value)) == sizeof(value) ? S_SUCCESS : E_INTERNAL;
+}
+
+status_t persist_delete(uint32_t key) {
+    fake_persist_counts.deletes++;
+    if (key < FAKE_KEYS) keys[key].used = false;
+    return S_SUCCESS;
+}
+
+// Overrides the C library's time() so tests can move the clock
+time_t time(time_t *result) {
+    time_t value = fake_time_now;
+    if (!value) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        value = now.tv_sec;
+    }
+    if (result) *result = value;
+    return value;
+}
+
+uint64_t fake_clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+void fake_wakeup_add_foreign(time_t timestamp) {
+    wakeups[wakeup_count++] = (FakeWakeup){ .id = next_wakeup_id++, .timestamp = timestamp, .foreign = true };
+}
+
+void fake_wakeup_clear(void) {
+    wakeup_count = 0;
+    fake_wakeup_syscalls = 0;
+}
+
+bool fake_wakeup_fire(time_t now, WakeupId *id) {
+    int8_t due = -1;
+    for (uint8_t i = 0; i < wakeup_count; i++) {
+        if (!wakeups[i].foreign && wakeups[i].timestamp <= now &&
+                (due < 0 || wakeups[i].timestamp < wakeups[due].timestamp)) {
+            due = i;
+        }
+    }
+    if (due < 0) {
+        return false;
+    }
+    *id = wakeups[due].id;
+    wakeups[due] = wakeups[--wakeup_count];
+    return true;
+}
+
+WakeupId wakeup_schedule(time_t timestamp, int32_t reason, bool notify_if_missed) {
+    fake_wakeup_syscalls++;
+    uint8_t ours = 0;
+    for (uint8_t i = 0; i < wakeup_count; i++) {
+        if (timestamp > wakeups[i].timestamp - FAKE_WAKEUP_SPACING &&
+                timestamp < wakeups[i].timestamp + FAKE_WAKEUP_SPACING) {
+            return E_RANGE;
+        }
+        if (!wakeups[i].foreign) ours++;
+    }
+    if (ours >= FAKE_APP_WAKEUPS || wakeup_count >= FAKE_WAKEUPS) {
+        return E_OUT_OF_RESOURCES;
+    }
+    wakeups[wakeup_count++] = (FakeWakeup){ .id = next_wakeup_id, .timestamp = timestamp };
+    return next_wakeup_id++;
+}
+
+void wakeup_cancel(WakeupId id) {
+    fake_wakeup_syscalls++;
+    for (uint8_t i = 0; i < wakeup_count; i++) {
+        if (wakeups[i].id == id && !wakeups[i].foreign) {
+            wakeups[i] = wakeups[--wakeup_count];
+            return;
+        }
+    }
+}
+
+void wakeup_cancel_all(void) {
+    fake_wakeup_syscalls++;
+    for (int i = wakeup_count - 1; i >= 0; i--) {
+        if (!wakeups[i].foreign) wakeups[i] = wakeups[--wakeup_count];
+    }
+}
+
+bool wakeup_query(WakeupId id, time_t *timestamp) {
+    for (uint8_t i = 0; i < wakeup_count; i++) {
+        if (wakeups[i].id == id && !wakeups[i].foreign) {
+            if (timestamp) *timestamp = wakeups[i].timestamp;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,43 @@
+/*
+  Test hooks for the fake SDK in fake_pebble.c.
+*/
+
+#pragma once
+#include <pebble.h>
+
+// Every persist call made since the last fake_persist_reset_counts()
+typedef struct {
+    uint32_t exists, reads, writes, deletes;
+    uint32_t bytes_read, bytes_written;
+} FakePersistCounts;
+
+extern FakePersistCounts fake_persist_counts;
+void fake_persist_reset_counts(void);
+// Wipes all keys, like a fresh install
+void fake_persist_clear(void);
+int fake_persist_used_bytes(void);
+
+// Bytes on the heap now, and the most there have been since the last
+// fake_heap_reset_peak()
+extern size_t fake_heap_used, fake_heap_peak;
+void fake_heap_reset_peak(void);
+
+// time() returns this instead of the host clock when it's not zero
+extern time_t fake_time_now;
+extern uint32_t fake_wakeup_syscalls;
+// Adds a wakeup owned by another app, which ours must keep a minute from
+void fake_wakeup_add_foreign(time_t timestamp);
+void fake_wakeup_clear(void);
+// Takes the app's earliest wakeup that is due by now off the watch, like it
+// firing, and returns its id in id
+bool fake_wakeup_fire(time_t now, WakeupId *id);
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        exit(1); \
+    } \
+} while (0)
+
+// Host wall clock in nanoseconds, for the benchmarks
+uint64_t fake_clock_ns(void);
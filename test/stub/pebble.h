@@ -0,0 +1,58 @@
+/*
+  Host stand-in for the parts of the Pebble SDK that the storage, time and
+  planning modules use, so they can be tested and measured off the watch.
+  Persistent storage and wakeups are kept in memory, see fake_pebble.c.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PBL_SDK_3 1
+
+#define PERSIST_DATA_MAX_LENGTH 256
+
+#define S_SUCCESS 0
+#define E_INVALID_ARGUMENT -2
+#define E_INTERNAL -3
+#define E_OUT_OF_RESOURCES -7
+#define E_RANGE -8
+#define E_DOES_NOT_EXIST -9
+
+#define APP_LOG_LEVEL_ERROR 1
+#define APP_LOG_LEVEL_WARNING 50
+#define APP_LOG_LEVEL_INFO 100
+#define APP_LOG_LEVEL_DEBUG 200
+#define APP_LOG(level, ...) (fake_log_lines++)
+
+#define ARRAY_LENGTH(array) (sizeof(array) / sizeof((array)[0]))
+
+typedef int32_t status_t;
+typedef int32_t WakeupId;
+
+extern int fake_log_lines;
+
+// Heap calls go through the fake SDK so tests can see how much is in use, see
+// fake_heap_peak in fake_pebble.h
+void *fake_malloc(size_t size);
+void fake_free(void *pointer);
+#define malloc(size) fake_malloc(size)
+#define free(pointer) fake_free(pointer)
+
+bool persist_exists(uint32_t key);
+int persist_get_size(uint32_t key);
+int32_t persist_read_int(uint32_t key);
+status_t persist_write_int(uint32_t key, int32_t value);
+int persist_read_data(uint32_t key, void *buffer, size_t size);
+int persist_write_data(uint32_t key, const void *data, size_t size);
+status_t persist_delete(uint32_t key);
+
+WakeupId wakeup_schedule(time_t timestamp, int32_t reason, bool notify_if_missed);
+void wakeup_cancel(WakeupId id);
+void wakeup_cancel_all(void);
+bool wakeup_query(WakeupId id, time_t *timestamp);
@@ -0,0 +1,94 @@
+// civil_from_days() against the C library for every hour from 1970 to 2100,
+// and the day clock's next reset against the p_mktime() code it replaced
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "CivilDate.h"
+#include "DayClock.h"
+
+time_t p_mktime(struct tm *timeptr);
+
+#define END_OF_DAY 3
+#define SEC_IN_DAY 86400
+
+#define HOURS_1970_TO_2101 1148328L
+
+static volatile int32_t sink;
+
+// get_next_reset_time() as it was before the day clock
+static time_t legacy_next_reset() {
+    time_t utc = time(NULL);
+    time_t current_time = utc + localtime(&utc)->tm_gmtoff;
+
+    struct tm *reset_time_struct = localtime(&current_time);
+    reset_time_struct->tm_hour = END_OF_DAY;
+    reset_time_struct->tm_min = 0;
+    reset_time_struct->tm_sec = 0;
+
+    time_t reset_time = p_mktime(reset_time_struct);
+    while ((int)reset_time < (int)current_time) {
+        reset_time += SEC_IN_DAY;
+    }
+    return reset_time;
+}
+
+int main() {
+    for (long hour = 0; hour < HOURS_1970_TO_2101; hour++) {
+        time_t t = hour * 3600;
+        struct tm utc;
+        gmtime_r(&t, &utc);
+        CivilDate date = civil_from_days(t / 86400);
+        CHECK(date.year == utc.tm_year + 1900);
+        CHECK(date.month == utc.tm_mon + 1);
+        CHECK(date.day == utc.tm_mday);
+
+        // The old routine agrees where it works at all, and gives up after 2020
+        time_t legacy = p_mktime(&utc);
+        CHECK(legacy == ((utc.tm_year <= 120) ? t : (time_t)-1));
+    }
+
+    // Dates before the epoch still work, which a time_t can hold
+    CivilDate date = civil_from_days(-1);
+    CHECK(date.year == 1969 && date.month == 12 && date.day == 31);
+
+    // The next reset the way the app used to work it out on every call, with
+    // localtime() and p_mktime(), against the day clock that replaced it.
+    // Times step a minute at a time through 2019 and 2020, where p_mktime()
+    // still works, and both must agree.
+    enum { MINUTES = (365 + 366) * 24 * 60 };
+    const time_t first = 1546300800 + 17;
+    day_clock_set_end_of_day(END_OF_DAY);
+    for (int32_t minute = 0; minute < MINUTES; minute += 7) {
+        fake_time_now = first + minute * 60;
+        CHECK(legacy_next_reset() == day_clock_next_reset());
+    }
+
+    uint64_t start = fake_clock_ns();
+    for (int32_t minute = 0; minute < MINUTES; minute++) {
+        fake_time_now = first + minute * 60;
+        sink += legacy_next_reset();
+    }
+    uint64_t legacy_ns = fake_clock_ns() - start;
+
+    // The cache is good until the next hour, so most calls only check it
+    start = fake_clock_ns();
+    for (int32_t minute = 0; minute < MINUTES; minute++) {
+        fake_time_now = first + minute * 60;
+        sink += day_clock_next_reset();
+    }
+    uint64_t cached_ns = fake_clock_ns() - start;
+
+    // Setting the end of day throws the cache away, so every call rebuilds it
+    start = fake_clock_ns();
+    for (int32_t minute = 0; minute < MINUTES; minute++) {
+        fake_time_now = first + minute * 60;
+        day_clock_set_end_of_day(END_OF_DAY);
+        sink += day_clock_next_reset();
+    }
+    uint64_t refresh_ns = fake_clock_ns() - start;
+    fake_time_now = 0;
+
+    printf("%ld hours checked\n", HOURS_1970_TO_2101);
+    printf("next reset: localtime + p_mktime %.1f ns/call, day clock %.1f ns/call (%.1f ns rebuilding every call)\n",
+        (double)legacy_ns / MINUTES, (double)cached_ns / MINUTES, (double)refresh_ns / MINUTES);
+    return 0;
+}
@@ -0,0 +1,77 @@
+// The cached day clock against the same values worked out from scratch on
+// every call, across daylight saving changes, plus how often it has to call
+// localtime() for a day of clicks
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "DayClock.h"
+
+typedef struct {
+    int32_t offset;
+    uint32_t today;
+    time_t next_reset;
+} Expected;
+
+// What the app used to work out on every call. Pebble's tm_gmtoff leaves
+// daylight saving out, so DayClock adds it, and the reference does the same.
+static Expected expected_at(time_t utc, uint8_t end_of_day) {
+    struct tm *t = localtime(&utc);
+    Expected e;
+    e.offset = t->tm_gmtoff + ((t->tm_isdst > 0) ? 3600 : 0);
+    time_t local = utc + e.offset;
+    e.today = (local - end_of_day * 3600) / 86400;
+    e.next_reset = (time_t)(e.today + 1) * 86400 + end_of_day * 3600;
+    return e;
+}
+
+static volatile uint32_t sink;
+
+int main() {
+    const char *zones[] = { "America/New_York", "Europe/Berlin", "Australia/Sydney", "UTC" };
+    for (uint8_t z = 0; z < ARRAY_LENGTH(zones); z++) {
+        setenv("TZ", zones[z], 1);
+        tzset();
+        for (uint8_t end_of_day = 0; end_of_day < 24; end_of_day += 7) {
+            day_clock_set_end_of_day(end_of_day);
+            // Two years in uneven steps, so both DST changes are crossed
+            for (fake_time_now = 1700000000; fake_time_now < 1700000000 + 2 * 365 * 86400; fake_time_now += 1789) {
+                Expected e = expected_at(fake_time_now, end_of_day);
+                CHECK(day_clock_utc_offset() == e.offset);
+                CHECK(day_clock_now() == fake_time_now + e.offset);
+                CHECK(day_clock_today() == e.today);
+                CHECK(day_clock_next_reset() == e.next_reset);
+            }
+        }
+    }
+
+    // A day of clicks: 2000 clicks, each asking for the time a few times
+    setenv("TZ", "America/New_York", 1);
+    tzset();
+    day_clock_set_end_of_day(0);
+    fake_time_now = 1710000000;
+    uint16_t before = day_clock_refreshes();
+    uint64_t start = fake_clock_ns();
+    for (uint16_t click = 0; click < 2000; click++) {
+        fake_time_now += 43;
+        for (uint8_t i = 0; i < 4; i++) {
+            sink += day_clock_today() + day_clock_utc_offset() + day_clock_next_reset();
+        }
+    }
+    uint64_t cached_ns = fake_clock_ns() - start;
+    uint16_t refreshes = day_clock_refreshes() - before;
+    CHECK(refreshes <= 25);
+
+    start = fake_clock_ns();
+    fake_time_now = 1710000000;
+    for (uint16_t click = 0; click < 2000; click++) {
+        fake_time_now += 43;
+        for (uint8_t i = 0; i < 4; i++) {
+            Expected e = expected_at(fake_time_now, 0);
+            sink += e.today + e.offset + e.next_reset;
+        }
+    }
+    uint64_t uncached_ns = fake_clock_ns() - start;
+
+    printf("2000 clicks over a day: %u localtime() calls cached, 8000 uncached\n", refreshes);
+    printf("per click: %.0f ns cached, %.0f ns uncached\n", cached_ns / 2000.0, uncached_ns / 2000.0);
+    return 0;
+}
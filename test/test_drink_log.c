@@ -0,0 +1,72 @@
+// Days logged through the drink log, including days with more events than it
+// holds. Totals must survive compaction, and a full log must keep every drink
+// in the hour it was logged in.
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "DrinkLog.h"
+
+static int32_t logged_ml[24];
+static uint16_t visited;
+
+static void add_event(const DrinkEvent *event, void *context) {
+    logged_ml[event->minute / 60] += event->delta_ml;
+    visited++;
+}
+
+// Logs events drinks spread between start and end minute, every fifth one
+// taken back again, and returns how far off the compacted hours are, in mL
+static int32_t log_day(uint16_t events, uint16_t start, uint16_t end, int32_t *total) {
+    int32_t drunk_ml[24] = { 0 };
+    *total = 0;
+    for (uint16_t i = 0; i < events; i++) {
+        uint16_t minute = start + (uint32_t)i * (end - start) / events + rand() % 3;
+        int16_t delta = (i % 5 == 4) ? -50 : 250;
+        drink_log_append(minute, delta);
+        drunk_ml[minute / 60] += delta;
+        *total += delta;
+    }
+
+    memset(logged_ml, 0, sizeof(logged_ml));
+    visited = 0;
+    drink_log_compact(add_event, NULL);
+    CHECK(drink_log_count() == 0);
+
+    int32_t logged_total = 0, misplaced = 0;
+    for (uint8_t h = 0; h < 24; h++) {
+        logged_total += logged_ml[h];
+        misplaced += abs(logged_ml[h] - drunk_ml[h]);
+    }
+    CHECK(logged_total == *total);
+    return misplaced / 2;
+}
+
+int main() {
+    srand(9);
+    drink_log_init();
+
+    // Clicks within a minute are one event
+    drink_log_append(10, 250);
+    drink_log_append(10, 250);
+    drink_log_append(11, -50);
+    CHECK(drink_log_count() == 2);
+    drink_log_deinit();
+    drink_log_init();
+    CHECK(drink_log_count() == 2);
+    drink_log_compact(add_event, NULL);
+
+    // A normal day fits without merging
+    int32_t total;
+    CHECK(log_day(40, 8 * 60, 22 * 60, &total) == 0);
+    CHECK(visited == 40);
+
+    // Heavy days: three to six times what the log holds
+    for (uint16_t events = 200; events <= 400; events += 100) {
+        int32_t misplaced = log_day(events, 7 * 60, 23 * 60, &total);
+        CHECK(visited == DRINK_LOG_PAGES * PERSIST_DATA_MAX_LENGTH / sizeof(DrinkEvent));
+        CHECK(misplaced == 0);
+        printf("%u events: all %d mL kept in their hour\n", events, total);
+    }
+
+    drink_log_deinit();
+    return 0;
+}
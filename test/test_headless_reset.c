@@ -0,0 +1,134 @@
+// The work a headless reset launch does, with stores that already hold a year
+// of days: load the snapshot, open the stores, finish the day, close them and
+// save. Counts the persist calls, times it on the host and measures the heap.
+// The background worker's rollover does the same with the stores opened one
+// at a time, and has to fit in the worker's memory.
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "SharedState.h"
+#include "PagedStore.h"
+#include "History.h"
+#include "Streaks.h"
+#include "IntakeIndex.h"
+#include "IntakePyramid.h"
+#include "DrinkLog.h"
+#include "IntakeProfile.h"
+#include "DayRecord.h"
+
+#define FIRST_DAY 19000
+#define DAYS 365
+// A worker gets about this much for its code, data and heap together
+#define WORKER_MEMORY 10240
+
+static uint32_t total_calls() {
+    return fake_persist_counts.exists + fake_persist_counts.reads + fake_persist_counts.writes +
+        fake_persist_counts.deletes;
+}
+
+// A day of drinks, logged while the app was open on earlier launches
+static void log_day(uint32_t day) {
+    drink_log_init();
+    for (uint16_t minute = 480; minute < 1320; minute += 90) {
+        drink_log_append(minute + day % 30, 250);
+    }
+    drink_log_deinit();
+}
+
+// What init() does on a WAKEUP_RESET_REASON launch, from the snapshot on,
+// or what the worker's roll_over_day() does
+static void reset_launch(uint32_t today, bool worker) {
+    PersistedState state;
+    CHECK(persist_read_data(STATE_KEY, &state, sizeof(state)) == sizeof(state));
+
+    if (worker) {
+        state.total_drinks += day_record_finish_one_at_a_time(state.current_date / SEC_IN_DAY,
+            state.current_oz, state.current_ml, state.unit_system == METRIC, state.goal == HALF_GALLON);
+        state.days_logged++;
+        state.current_date = (time_t)today * SEC_IN_DAY;
+        state.current_ml = 0;
+
+        streaks_init();
+        state.streak_count = streaks_current(today);
+        streaks_deinit();
+        persist_write_data(STATE_KEY, &state, sizeof(state));
+        return;
+    }
+
+    history_init();
+    streaks_init();
+    intake_index_init();
+    intake_pyramid_init();
+    drink_log_init();
+    intake_profile_init();
+
+    state.total_drinks += day_record_finish(state.current_date / SEC_IN_DAY, state.current_oz,
+        state.current_ml, state.unit_system == METRIC, state.goal == HALF_GALLON);
+    state.days_logged++;
+    state.current_date = (time_t)today * SEC_IN_DAY;
+    state.current_ml = 0;
+    state.streak_count = streaks_current(today);
+
+    history_deinit();
+    streaks_deinit();
+    intake_index_deinit();
+    intake_pyramid_deinit();
+    drink_log_deinit();
+    intake_profile_deinit();
+    persist_write_data(STATE_KEY, &state, sizeof(state));
+}
+
+// A year of reset launches from a fresh install
+static void run_year(bool worker) {
+    fake_persist_clear();
+    PersistedState state = {
+        .version = STATE_VERSION,
+        .unit_system = METRIC,
+        .current_date = (time_t)FIRST_DAY * SEC_IN_DAY,
+    };
+    persist_write_data(STATE_KEY, &state, sizeof(state));
+
+    uint32_t calls = 0, max_calls = 0, bytes_written = 0;
+    uint64_t total_ns = 0, max_ns = 0;
+    size_t heap_peak = 0;
+    for (uint32_t day = FIRST_DAY; day < FIRST_DAY + DAYS; day++) {
+        log_day(day);
+        CHECK(persist_read_data(STATE_KEY, &state, sizeof(state)) == sizeof(state));
+        state.current_ml = 1000 + day % 3000;
+        persist_write_data(STATE_KEY, &state, sizeof(state));
+
+        fake_persist_reset_counts();
+        fake_heap_reset_peak();
+        uint64_t start = fake_clock_ns();
+        reset_launch(day + 1, worker);
+        uint64_t elapsed = fake_clock_ns() - start;
+
+        total_ns += elapsed;
+        if (elapsed > max_ns) max_ns = elapsed;
+        calls += total_calls();
+        if (total_calls() > max_calls) max_calls = total_calls();
+        bytes_written += fake_persist_counts.bytes_written;
+        if (fake_heap_peak > heap_peak) heap_peak = fake_heap_peak;
+        CHECK(drink_log_count() == 0);
+        CHECK(fake_heap_used == 0);
+    }
+
+    CHECK(persist_read_data(STATE_KEY, &state, sizeof(state)) == sizeof(state));
+    CHECK(state.days_logged == DAYS);
+    CHECK(state.current_date == (time_t)(FIRST_DAY + DAYS) * SEC_IN_DAY);
+    if (worker) {
+        // Never more than one store's cached pages at once
+        CHECK(heap_peak <= PAGED_STORE_CACHE_PAGES * PAGED_STORE_PAGE_SIZE);
+    }
+
+    printf("%s, %d reset launches: %.1f persist calls each (at most %u), %.0f bytes written\n",
+        worker ? "worker" : "app", DAYS, (float)calls / DAYS, max_calls, (float)bytes_written / DAYS);
+    printf("  host time %.1f us each, at most %.1f us, heap peak %zu bytes (%.0f%% of a worker's %d)\n",
+        total_ns / 1000.0 / DAYS, max_ns / 1000.0, heap_peak, heap_peak * 100.0 / WORKER_MEMORY,
+        WORKER_MEMORY);
+}
+
+int main() {
+    run_year(false);
+    run_year(true);
+    return 0;
+}
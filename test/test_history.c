@@ -0,0 +1,79 @@
+// Ten years of synthetic days through the history codec and store: every
+// record that is still stored must read back exactly, and decoded volumes
+// must be within one level of what was drunk
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "History.h"
+
+#define FIRST_DAY 16000
+#define DAYS (10 * 365 + 2)
+
+static uint8_t expected[DAYS];
+
+int main() {
+    srand(5);
+    history_init();
+
+    uint64_t start = fake_clock_ns();
+    uint32_t day = FIRST_DAY;
+    uint32_t appended = 0;
+    while (day < FIRST_DAY + DAYS) {
+        bool metric = rand() % 2;
+        bool half_gallon = rand() % 2;
+        uint16_t goal = (metric ? 4000 : 128) / (half_gallon ? 2 : 1);
+        uint16_t volume = rand() % (goal + goal / 4);
+        uint8_t record = history_encode(volume, goal, metric, half_gallon);
+
+        CHECK(history_goal_met(record) == (volume >= goal));
+        uint16_t goal_oz = half_gallon ? 64 : 128;
+        uint16_t volume_oz = (volume >= goal ? goal : volume) * goal_oz / goal;
+        int16_t error = (int16_t)history_volume_oz(record) - (int16_t)volume_oz;
+        CHECK(error >= -(goal_oz / HISTORY_FULL + 1) && error <= goal_oz / HISTORY_FULL + 1);
+
+        // Some days the app isn't opened, which leaves them empty
+        if (rand() % 20 == 0) {
+            uint32_t skipped = 1 + rand() % 4;
+            for (uint32_t i = 0; i < skipped && day < FIRST_DAY + DAYS; i++, day++) {
+                expected[day - FIRST_DAY] = record & ~HISTORY_LEVEL_MASK;
+            }
+            if (day >= FIRST_DAY + DAYS) break;
+        }
+        history_append(day, record);
+        expected[day - FIRST_DAY] = record;
+        appended++;
+        day++;
+
+        // Closing and opening the app in between
+        if (day % 97 == 0) {
+            history_deinit();
+            history_init();
+        }
+    }
+    uint64_t append_ns = fake_clock_ns() - start;
+
+    uint32_t first = history_first_day(), end = history_end_day();
+    CHECK(end == day);
+    CHECK(end - first >= (HISTORY_PAGES - 1) * PERSIST_DATA_MAX_LENGTH);
+    CHECK(end - first <= HISTORY_PAGES * PERSIST_DATA_MAX_LENGTH);
+
+    start = fake_clock_ns();
+    uint32_t reads = 0;
+    for (int pass = 0; pass < 100; pass++) {
+        for (uint32_t d = first; d < end; d++) {
+            uint8_t record;
+            CHECK(history_read(d, &record));
+            CHECK(record == expected[d - FIRST_DAY]);
+            reads++;
+        }
+    }
+    uint64_t read_ns = fake_clock_ns() - start;
+
+    uint8_t record;
+    CHECK(!history_read(first - 1, &record));
+    CHECK(!history_read(end, &record));
+    history_deinit();
+
+    printf("%u days appended, last %u kept in %d bytes\n", appended, end - first, fake_persist_used_bytes());
+    printf("append %.0f ns/day, read %.0f ns/day\n", (double)append_ns / appended, (double)read_ns / reads);
+    return 0;
+}
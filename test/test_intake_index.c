@@ -0,0 +1,43 @@
+// Range sums from the intake index against a plain array, for heavy drinkers
+// whose yearly total doesn't fit in the index's 16 bit nodes
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "IntakeIndex.h"
+
+#define FIRST_DAY 19000
+#define DAYS 700
+
+static uint16_t expected[DAYS];
+
+int main() {
+    intake_index_init();
+    for (uint32_t d = 0; d < DAYS; d++) {
+        // Some days go past the cap, which is what the index keeps for them
+        uint16_t oz = 150 + (d * 37) % 200;
+        expected[d] = (oz > INTAKE_INDEX_MAX_OZ) ? INTAKE_INDEX_MAX_OZ : oz;
+        intake_index_set(FIRST_DAY + d, oz);
+    }
+    intake_index_deinit();
+    intake_index_init();
+
+    uint32_t end = FIRST_DAY + DAYS;
+    for (uint32_t length = 1; length < INTAKE_INDEX_DAYS; length += 17) {
+        uint32_t sum = 0;
+        for (uint32_t d = DAYS - length; d < DAYS; d++) {
+            sum += expected[d];
+        }
+        CHECK(intake_index_sum(end - length, end) == sum);
+    }
+
+    uint32_t year = intake_index_sum(end - 365, end);
+    CHECK(year > UINT16_MAX);
+    for (uint32_t d = 0; d < DAYS; d += 13) {
+        if (FIRST_DAY + d >= end - (INTAKE_INDEX_DAYS - 1)) {
+            CHECK(intake_index_get(FIRST_DAY + d) == expected[d]);
+        }
+    }
+    intake_index_deinit();
+
+    printf("%u oz over the last 365 days, exact past the 16 bit nodes\n", year);
+    return 0;
+}
@@ -0,0 +1,43 @@
+// Pyramid buckets against totals worked out directly, for a heavy drinker
+// whose yearly sum doesn't fit in 16 bits
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "IntakePyramid.h"
+
+// 2023-01-01 to 2024-12-31
+#define FIRST_DAY 19358
+#define DAYS 731
+
+int main() {
+    uint32_t year_sum[200] = { 0 };
+    uint16_t year_days[200] = { 0 };
+
+    intake_pyramid_init();
+    for (uint32_t day = FIRST_DAY; day < FIRST_DAY + DAYS; day++) {
+        uint16_t oz = 200 + day % 56;
+        intake_pyramid_add_day(day, oz);
+        uint32_t year = intake_pyramid_bucket_of(PYRAMID_YEAR, day);
+        year_sum[year] += oz;
+        year_days[year]++;
+    }
+    intake_pyramid_deinit();
+    intake_pyramid_init();
+
+    for (uint32_t year = 123; year <= 124; year++) {
+        PyramidBucket bucket;
+        CHECK(intake_pyramid_read(PYRAMID_YEAR, year, &bucket));
+        CHECK(bucket.days == year_days[year] && bucket.sum == year_sum[year]);
+        CHECK(bucket.sum > UINT16_MAX);
+        CHECK(bucket.min == 200 && bucket.max == 255);
+    }
+
+    // Weeks and months still read back what was added to them
+    PyramidBucket week;
+    uint32_t last = FIRST_DAY + DAYS - 1;
+    CHECK(intake_pyramid_read(PYRAMID_WEEK, intake_pyramid_bucket_of(PYRAMID_WEEK, last - 7), &week));
+    CHECK(week.days == 7 && week.sum >= 7 * 200 && week.sum <= 7 * 255);
+    intake_pyramid_deinit();
+
+    printf("2024 total %u oz over %u days, past 16 bits\n", year_sum[124], year_days[124]);
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Persist calls per launch with the STATE_KEY snapshot versus the one key per
+// field layout it replaced, plus the paged stores every launch opens. The
+// snapshot side goes through StateStore, which load_persistent_storage() and
+// save_persistent_storage() call.
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "SharedState.h"
+#include "StateStore.h"
+#include "History.h"
+#include "Streaks.h"
+#include "IntakeIndex.h"
+#include "IntakePyramid.h"
+#include "DrinkLog.h"
+#include "IntakeProfile.h"
+#include "DayRecord.h"
+
+// The legacy keys, CURRENT_OZ_KEY through DRINKING_SINCE_KEY in StateStore.c
+static const uint32_t legacy_keys[] = {
+    1003, 1013, 1012, 1006, 1010, 1011, 1005, 1004, 1001, 1000, 1002, 1007, 1008, 1014, 1015, 1009
+};
+
+static uint32_t total_calls() {
+    return fake_persist_counts.exists + fake_persist_counts.reads + fake_persist_counts.writes +
+        fake_persist_counts.deletes;
+}
+
+// What load_persistent_storage() and save_persistent_storage() did before
+// the snapshot. That code is gone from the app, so this is the only copy.
+static void legacy_launch() {
+    int32_t values[ARRAY_LENGTH(legacy_keys)];
+    for (uint8_t i = 0; i < ARRAY_LENGTH(legacy_keys); i++) {
+        values[i] = persist_exists(legacy_keys[i]) ? persist_read_int(legacy_keys[i]) : 0;
+    }
+    for (uint8_t i = 0; i < ARRAY_LENGTH(legacy_keys); i++) {
+        persist_write_int(legacy_keys[i], values[i]);
+    }
+}
+
+static void snapshot_launch() {
+    PersistedState state;
+    CHECK(state_store_load(&state, 0));
+    state_store_save(&state);
+}
+
+static void stores_init() {
+    history_init();
+    streaks_init();
+    intake_index_init();
+    intake_pyramid_init();
+    drink_log_init();
+    intake_profile_init();
+}
+
+static void stores_deinit() {
+    history_deinit();
+    streaks_deinit();
+    intake_index_deinit();
+    intake_pyramid_deinit();
+    drink_log_deinit();
+    intake_profile_deinit();
+}
+
+int main() {
+    CHECK(sizeof(PersistedState) <= PERSIST_DATA_MAX_LENGTH);
+    // Version 1 snapshots are recognized by their size, so it must not change
+    CHECK(STATE_V1_SIZE == 31);
+
+    for (uint8_t i = 0; i < ARRAY_LENGTH(legacy_keys); i++) {
+        persist_write_int(legacy_keys[i], i);
+    }
+    fake_persist_reset_counts();
+    legacy_launch();
+    uint32_t legacy_calls = total_calls();
+    CHECK(legacy_calls == 48);
+
+    // The first launch after updating moves the keys into the snapshot once
+    PersistedState state;
+    fake_persist_reset_counts();
+    CHECK(!state_store_load(&state, 0));
+    uint32_t migrate_calls = total_calls();
+    CHECK(state.version == STATE_VERSION);
+    CHECK(state.streak_count == 8 && state.cdu_ml == 14 && state.drinking_since == 15);
+    for (uint8_t i = 0; i < ARRAY_LENGTH(legacy_keys); i++) {
+        CHECK(!persist_exists(legacy_keys[i]));
+    }
+
+    fake_persist_reset_counts();
+    snapshot_launch();
+    uint32_t snapshot_calls = total_calls();
+    CHECK(snapshot_calls == 2);
+
+    // A snapshot from a newer version, with fields this one doesn't know,
+    // keeps everything this version knows
+    uint8_t newer[sizeof(PersistedState) + 8];
+    memset(newer, 0xAB, sizeof(newer));
+    state.version = STATE_VERSION + 1;
+    state.streak_count = 42;
+    memcpy(newer, &state, sizeof(state));
+    persist_write_data(STATE_KEY, newer, sizeof(newer));
+    fake_persist_reset_counts();
+    CHECK(state_store_load(&state, 0));
+    CHECK(state.version == STATE_VERSION && state.streak_count == 42 && state.cdu_ml == 14);
+    CHECK(fake_persist_counts.writes == 0 && fake_persist_counts.deletes == 0);
+
+    // Version 1 snapshots are shorter and leave the newer fields zero
+    state.version = 1;
+    state.total_consumed_v1 = 500;
+    persist_write_data(STATE_KEY, &state, STATE_V1_SIZE);
+    CHECK(state_store_load(&state, 0));
+    CHECK(state.version == 1 && state.total_consumed_v1 == 500 && state.total_consumed == 0);
+
+    // A year of finished days, so every store has pages to load
+    stores_init();
+    for (uint32_t day = 19000; day < 19365; day++) {
+        drink_log_append(600, 250);
+        drink_log_append(900, 500);
+        day_record_finish(day, 0, 1000 + day % 3000, true, false);
+        streaks_set_goal_met(day, day % 4 != 0);
+    }
+    stores_deinit();
+
+    // Opening the app and closing it without logging anything
+    fake_persist_reset_counts();
+    stores_init();
+    streaks_current(19364);
+    stores_deinit();
+    uint32_t idle_store_calls = total_calls();
+    uint32_t idle_store_writes = fake_persist_counts.writes;
+    CHECK(idle_store_writes == 0);
+
+    // Opening the app and logging one drink
+    fake_persist_reset_counts();
+    stores_init();
+    drink_log_append(700, 250);
+    stores_deinit();
+    uint32_t drink_store_writes = fake_persist_counts.writes;
+    CHECK(drink_store_writes <= 2);
+
+    printf("persist calls per launch: legacy state %u, snapshot %u, migrating once %u\n",
+        legacy_calls, snapshot_calls, migrate_calls);
+    printf("paged stores: %u calls opening and closing with no change (%u writes), %u writes after one drink\n",
+        idle_store_calls, idle_store_writes, drink_store_writes);
+    return 0;
+}
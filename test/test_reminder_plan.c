@@ -0,0 +1,149 @@
+// Days of auto reminders, planned one at a time like the app does and as a
+// whole-day timetable like it used to, counting how often a reminder
+// launches the app and how many wakeup calls each launch has to make. The
+// user answers half the reminders with a drink and ignores the rest, which
+// backs the next ones off, like the reminder window does.
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "DayClock.h"
+#include "WakeupPlanner.h"
+#include "IntakeProfile.h"
+#include "ReminderPlan.h"
+
+// Same values as GallonChallenge.h
+#define WAKEUP_REMINDER_REASON 2000
+#define REMINDER_SLOTS (WAKEUP_PLANNER_SLOTS - 1)
+#define REMINDER_TOLERANCE (10 * 60)
+
+#define DAYS 365
+#define DAY_START 1704067200
+#define UNITS_GOAL 8.0f
+
+typedef struct {
+    uint32_t launches;
+    uint32_t launch_syscalls;
+    uint32_t syscalls;
+} Totals;
+
+static uint32_t seed = 1;
+
+static uint32_t next_random() {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7FFF;
+}
+
+// Auto mode as get_reminder_times() works it out, spaced over the rest of the
+// day or paced by a profile of even drinking, into the given number of slots
+static void plan(time_t now, time_t day_start, float units_done, uint8_t backoff, bool paced, uint8_t slots) {
+    time_t times[REMINDER_SLOTS];
+    uint8_t count = 0;
+    float units_left = UNITS_GOAL - units_done;
+    if (units_left > 0) {
+        ReminderDay day = {
+            .now = now,
+            .day_start = day_start,
+            .last = day_start + 86400 - 2 * 3600,
+            .backoff = backoff,
+        };
+        if (paced) {
+            count = reminder_plan_paced(&day, units_done, UNITS_GOAL, times, slots);
+        } else {
+            float hours_left = (day.last - now) / 3600.0;
+            if (hours_left < 0) hours_left = 0;
+            count = (units_left < slots) ? (uint8_t)(units_left + 0.999) : slots;
+            count = reminder_plan_spaced(&day, hours_left / units_left, count, times, slots);
+        }
+    }
+    wakeup_planner_sync(WAKEUP_REMINDER_REASON, times, count, REMINDER_TOLERANCE, false);
+}
+
+// The user also opens the app to log a drink a few times a day on their own
+static Totals simulate(bool paced, uint8_t slots) {
+    Totals totals = { 0 };
+    seed = 1;
+    fake_persist_clear();
+    fake_wakeup_clear();
+    wakeup_planner_init();
+    // A profile of a unit an hour from 8:00 to 15:59
+    intake_profile_init();
+    int32_t hourly_ml[INTAKE_PROFILE_HOURS] = { 0 };
+    for (uint8_t hour = 8; hour < 16; hour++) {
+        hourly_ml[hour] = 250;
+    }
+    for (uint8_t d = 0; d < INTAKE_PROFILE_MIN_DAYS; d++) {
+        intake_profile_add_day(hourly_ml);
+    }
+    // Quiet from 22:00 until 07:59, like get_quiet_hours() with the day
+    // ending at midnight and starting at 7
+    wakeup_planner_set_quiet_hours(0xC000FF);
+
+    for (uint16_t d = 0; d < DAYS; d++) {
+        time_t day_start = DAY_START + (time_t)d * 86400;
+        float units_done = 0;
+        uint8_t backoff = 1;
+        fake_time_now = day_start;
+        plan(day_start, day_start, units_done, backoff, paced, slots);
+
+        uint16_t own_drinks = next_random() % 4;
+        time_t drink_at[4];
+        for (uint8_t i = 0; i < own_drinks; i++) {
+            drink_at[i] = day_start + (8 + next_random() % 14) * 3600 + next_random() % 3600;
+        }
+
+        for (time_t t = day_start; t < day_start + 86400; t += 60) {
+            fake_time_now = t;
+            for (uint8_t i = 0; i < own_drinks; i++) {
+                if (drink_at[i] >= t && drink_at[i] < t + 60) {
+                    units_done++;
+                    backoff = 1;
+                    plan(t, day_start, units_done, backoff, paced, slots);
+                }
+            }
+            WakeupId id;
+            while (fake_wakeup_fire(t, &id)) {
+                uint32_t before = fake_wakeup_syscalls;
+                totals.launches++;
+                wakeup_planner_forget(id);
+                // A timetable used to be planned again as soon as it ran out.
+                // The next reminder is planned once the user has answered or
+                // ignored this one.
+                if (slots > 1 && !wakeup_planner_find(WAKEUP_REMINDER_REASON, NULL)) {
+                    plan(t, day_start, units_done, backoff, paced, slots);
+                }
+                if (next_random() % 2) {
+                    units_done++;
+                    backoff = 1;
+                } else if (backoff < 8) {
+                    backoff *= 2;
+                }
+                plan(t, day_start, units_done, backoff, paced, slots);
+                totals.launch_syscalls += fake_wakeup_syscalls - before;
+            }
+        }
+    }
+    totals.syscalls = fake_wakeup_syscalls;
+    intake_profile_deinit();
+    return totals;
+}
+
+int main() {
+    setenv("TZ", "UTC", 1);
+    tzset();
+    day_clock_set_end_of_day(0);
+
+    static const char *names[] = { "spaced", "paced" };
+    printf("%d days of auto reminders, goal of %.0f units\n", DAYS, UNITS_GOAL);
+    for (uint8_t paced = 0; paced < 2; paced++) {
+        Totals single = simulate(paced, 1);
+        Totals day = simulate(paced, REMINDER_SLOTS);
+        CHECK(single.launches > 0 && day.launches > 0);
+        CHECK(single.syscalls < day.syscalls);
+        printf("  %s, next reminder only:  %.2f launches a day, %.2f wakeup calls per launch, %.1f a day\n",
+            names[paced], (float)single.launches / DAYS, (float)single.launch_syscalls / single.launches,
+            (float)single.syscalls / DAYS);
+        printf("  %s, whole-day timetable: %.2f launches a day, %.2f wakeup calls per launch, %.1f a day\n",
+            names[paced], (float)day.launches / DAYS, (float)day.launch_syscalls / day.launches,
+            (float)day.syscalls / DAYS);
+    }
+    return 0;
+}
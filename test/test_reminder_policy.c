@@ -0,0 +1,175 @@
+// Auto reminders spaced evenly over the rest of the day versus paced by the
+// learned intake profile while it would meet the goal, for a few made-up
+// kinds of drinker. Reports how many reminders go off a day and how often the
+// goal is met.
+#include <pebble.h>
+#include "fake_pebble.h"
+#include "DayClock.h"
+#include "WakeupPlanner.h"
+#include "IntakeProfile.h"
+#include "ReminderPlan.h"
+
+// Same values as GallonChallenge.h
+#define REMINDER_SLOTS (WAKEUP_PLANNER_SLOTS - 1)
+#define REMINDER_BACKOFF_MAX 8
+
+#define DAY_START 1704067200
+// Days before the profile is trusted are left out of the results
+#define WARMUP_DAYS 14
+#define DAYS 200
+#define UNIT_ML 250
+#define UNITS_GOAL 8
+// Chances out of 100 that a usual drink happens and that a reminder is
+// answered with a drink
+#define USUAL_DRINK_CHANCE 70
+#define ANSWER_CHANCE 50
+
+typedef struct {
+    const char *name;
+    // Minutes after midnight of the usual drinks, 0 ends the list
+    uint16_t minutes[UNITS_GOAL + 1];
+} Drinker;
+
+static const Drinker drinkers[] = {
+    { "morning", { 7 * 60, 8 * 60, 9 * 60, 10 * 60, 11 * 60, 12 * 60, 14 * 60, 0 } },
+    { "evening", { 9 * 60, 15 * 60, 17 * 60, 18 * 60, 19 * 60, 20 * 60, 21 * 60, 0 } },
+    { "even", { 8 * 60, 10 * 60, 12 * 60, 14 * 60, 16 * 60, 18 * 60, 20 * 60, 0 } },
+    // Irregular drinkers get random minutes instead, see usual_drinks()
+    { "irregular", { 0 } },
+};
+
+typedef struct {
+    uint32_t reminders;
+    uint32_t days_met;
+} Result;
+
+static uint32_t seed;
+
+static uint32_t next_random() {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7FFF;
+}
+
+// Today's drinks without any reminders, sorted
+static uint8_t usual_drinks(const Drinker *drinker, uint16_t *minutes) {
+    uint8_t count = 0;
+    if (!drinker->minutes[0]) {
+        uint8_t drinks = 3 + next_random() % 6;
+        for (uint8_t i = 0; i < drinks; i++) {
+            minutes[count++] = 7 * 60 + next_random() % (15 * 60);
+        }
+    } else {
+        for (uint8_t i = 0; drinker->minutes[i]; i++) {
+            if (next_random() % 100 < USUAL_DRINK_CHANCE) {
+                minutes[count++] = drinker->minutes[i] - 30 + next_random() % 61;
+            }
+        }
+    }
+    for (uint8_t i = 1; i < count; i++) {
+        for (uint8_t j = i; j > 0 && minutes[j - 1] > minutes[j]; j--) {
+            uint16_t swap = minutes[j];
+            minutes[j] = minutes[j - 1];
+            minutes[j - 1] = swap;
+        }
+    }
+    return count;
+}
+
+// The next reminder as get_reminder_times() works it out in auto mode, or 0
+static time_t next_reminder(bool paced, time_t now, time_t day_start, uint8_t units_done, uint8_t backoff) {
+    if (units_done >= UNITS_GOAL) {
+        return 0;
+    }
+    ReminderDay day = {
+        .now = now,
+        .day_start = day_start,
+        .last = day_start + 86400 - 2 * 3600,
+        .backoff = backoff,
+    };
+    time_t times[REMINDER_SLOTS];
+    uint8_t count;
+    if (paced && intake_profile_ready() &&
+            reminder_plan_on_pace(&day, units_done, UNITS_GOAL, UNITS_GOAL * UNIT_ML)) {
+        count = reminder_plan_paced(&day, units_done, UNITS_GOAL, times, REMINDER_SLOTS);
+    } else {
+        float units_left = UNITS_GOAL - units_done;
+        float hours_left = (day.last - now) / 3600.0;
+        if (hours_left < 0) hours_left = 0;
+        count = reminder_plan_spaced(&day, hours_left / units_left, (uint8_t)units_left, times, REMINDER_SLOTS);
+    }
+    // The first reminder is always kept, but not past the end of the day
+    return (count && times[0] < day_start + 86400) ? times[0] : 0;
+}
+
+static Result simulate(const Drinker *drinker, bool paced) {
+    Result result = { 0 };
+    seed = 7;
+    fake_persist_clear();
+    intake_profile_init();
+
+    for (uint16_t d = 0; d < WARMUP_DAYS + DAYS; d++) {
+        time_t day_start = DAY_START + (time_t)d * 86400;
+        uint16_t usual[UNITS_GOAL + 8];
+        uint8_t usual_count = usual_drinks(drinker, usual);
+        uint8_t next_usual = 0;
+        int32_t hourly_ml[INTAKE_PROFILE_HOURS] = { 0 };
+        uint8_t units_done = 0, backoff = 1;
+        uint32_t reminders = 0;
+
+        time_t reminder = next_reminder(paced, day_start, day_start, units_done, backoff);
+        for (uint16_t minute = 0; minute < 24 * 60; minute++) {
+            time_t t = day_start + minute * 60;
+            bool drank = false;
+            while (next_usual < usual_count && usual[next_usual] == minute) {
+                next_usual++;
+                drank = true;
+            }
+            if (reminder && t >= reminder) {
+                reminders++;
+                if (next_random() % 100 < ANSWER_CHANCE) {
+                    drank = true;
+                } else if (backoff < REMINDER_BACKOFF_MAX) {
+                    backoff *= 2;
+                }
+                reminder = next_reminder(paced, t, day_start, units_done, backoff);
+            }
+            if (drank) {
+                units_done++;
+                backoff = 1;
+                hourly_ml[minute / 60] += UNIT_ML;
+                reminder = next_reminder(paced, t, day_start, units_done, backoff);
+            }
+        }
+
+        intake_profile_add_day(hourly_ml);
+        if (d >= WARMUP_DAYS) {
+            result.reminders += reminders;
+            if (units_done >= UNITS_GOAL) result.days_met++;
+        }
+    }
+    intake_profile_deinit();
+    return result;
+}
+
+int main() {
+    setenv("TZ", "UTC", 1);
+    tzset();
+    day_clock_set_end_of_day(0);
+    wakeup_planner_init();
+    // Quiet from 22:00 until 07:59, like get_quiet_hours() with the day
+    // ending at midnight and starting at 7
+    wakeup_planner_set_quiet_hours(0xC000FF);
+
+    printf("%d days per drinker, goal of %d units, %d%% of reminders answered\n", DAYS, UNITS_GOAL, ANSWER_CHANCE);
+    printf("  %-10s %24s %24s\n", "", "spaced", "paced");
+    for (uint8_t i = 0; i < ARRAY_LENGTH(drinkers); i++) {
+        Result spaced = simulate(&drinkers[i], false);
+        Result paced = simulate(&drinkers[i], true);
+        CHECK(spaced.reminders > 0);
+        CHECK(paced.days_met >= spaced.days_met);
+        printf("  %-10s %5.2f a day, %3u%% met %11.2f a day, %3u%% met\n", drinkers[i].name,
+            (float)spaced.reminders / DAYS, spaced.days_met * 100 / DAYS,
+            (float)paced.reminders / DAYS, paced.days_met * 100 / DAYS);
+    }
+    return 0;
+}
@@ -0,0 +1,180 @@
+#
+# Generates the volume -> fill height lookup tables used by container_height()
+# from the container bitmaps in resources/images.
+#
+# The main window leaves out the unfilled part of the container, starting
+# MASK_TOP rows into the bitmap, when it draws the filled image. For every
+# volume step we find the most rows that can be left out while still showing
+# at least that fraction of the container's interior, so the water level
+# follows the real shape of the image.
+#
+# Only depends on the python standard library so it runs inside the SDK's
+# waf environment.
+#
+
+import struct
+import zlib
+
+MASK_TOP = 5
+EMPTY_HEIGHT = 93
+
+OZ_IN_GAL = 128
+ML_IN_GAL = 4000
+ML_STEP = 25
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+
+
+def _paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    if pb <= pc:
+        return b
+    return c
+
+
+def read_png(path):
+    """Decodes an 8-bit palette PNG into rows of (r, g, b, a) tuples."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != PNG_SIGNATURE:
+        raise ValueError('{} is not a PNG'.format(path))
+
+    pos = 8
+    header = palette = None
+    alpha = b''
+    idat = b''
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b'IHDR':
+            header = struct.unpack('>IIBBBBB', body)
+        elif kind == b'PLTE':
+            palette = bytearray(body)
+        elif kind == b'tRNS':
+            alpha = bytearray(body)
+        elif kind == b'IDAT':
+            idat += body
+
+    width, height, depth, color_type, _, _, interlace = header
+    if depth != 8 or color_type != 3 or interlace != 0:
+        raise ValueError('{} must be an 8-bit non-interlaced palette PNG'.format(path))
+
+    raw = bytearray(zlib.decompress(idat))
+    rows = []
+    prev = bytearray(width)
+    i = 0
+    for _ in range(height):
+        kind = raw[i]
+        line = raw[i + 1:i + 1 + width]
+        i += 1 + width
+        for x in range(width):
+            a = line[x - 1] if x > 0 else 0
+            b = prev[x]
+            c = prev[x - 1] if x > 0 else 0
+            if kind == 1:
+                line[x] = (line[x] + a) & 0xff
+            elif kind == 2:
+                line[x] = (line[x] + b) & 0xff
+            elif kind == 3:
+                line[x] = (line[x] + (a + b) // 2) & 0xff
+            elif kind == 4:
+                line[x] = (line[x] + _paeth(a, b, c)) & 0xff
+        rows.append([(palette[3 * p], palette[3 * p + 1], palette[3 * p + 2],
+                      alpha[p] if p < len(alpha) else 255) for p in line])
+        prev = line
+    return rows
+
+
+def interior_widths(outline_path, filled_path):
+    """Counts the fillable pixels on each row of a container.
+
+    A pixel is fillable when it is enclosed by the black outline and the
+    filled version of the image actually draws water there.
+    """
+    outline = read_png(outline_path)
+    filled = read_png(filled_path)
+    height, width = len(outline), len(outline[0])
+
+    def is_wall(x, y):
+        r, g, b, a = outline[y][x]
+        return a != 0 and r == 0 and g == 0 and b == 0
+
+    # Flood the outside of the container from the image border
+    outside = [[False] * width for _ in range(height)]
+    stack = [(x, y) for x in range(width) for y in (0, height - 1)]
+    stack += [(x, y) for y in range(height) for x in (0, width - 1)]
+    while stack:
+        x, y = stack.pop()
+        if outside[y][x] or is_wall(x, y):
+            continue
+        outside[y][x] = True
+        for nx, ny in ((x - 1, y), (x + 1, y), (x, y - 1), (x, y + 1)):
+            if 0 <= nx < width and 0 <= ny < height:
+                stack.append((nx, ny))
+
+    background = filled[0][0]
+    return [sum(1 for x in range(width)
+                if not outside[y][x] and not is_wall(x, y) and filled[y][x] != background)
+            for y in range(height)]
+
+
+def fill_table(widths, steps):
+    """Mask height for each of volume 0..steps out of a full container."""
+    visible = [0] * (len(widths) + 1)
+    for y in range(len(widths) - 1, -1, -1):
+        visible[y] = visible[y + 1] + widths[y]
+    total = visible[MASK_TOP]
+
+    def visible_below(h):
+        y = MASK_TOP + h
+        return visible[y] if y < len(visible) else 0
+
+    table = [EMPTY_HEIGHT]
+    for vol in range(1, steps + 1):
+        h = EMPTY_HEIGHT
+        while h > 0 and visible_below(h) * steps < vol * total:
+            h -= 1
+        table.append(h)
+    return table
+
+
+def _format_table(name, table):
+    lines = ['static const uint8_t {}[{}] = {{'.format(name, len(table))]
+    for i in range(0, len(table), 16):
+        lines.append('    ' + ', '.join('{:2d}'.format(v) for v in table[i:i + 16]) + ',')
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def write_header(out_path, gallon, half_gallon):
+    """gallon and half_gallon are (outline_path, filled_path) pairs."""
+    gallon_widths = interior_widths(*gallon)
+    half_gallon_widths = interior_widths(*half_gallon)
+
+    tables = [
+        ('GALLON_OZ_FILL_TABLE', fill_table(gallon_widths, OZ_IN_GAL)),
+        ('HALF_GALLON_OZ_FILL_TABLE', fill_table(half_gallon_widths, OZ_IN_GAL // 2)),
+        ('GALLON_ML_FILL_TABLE', fill_table(gallon_widths, ML_IN_GAL // ML_STEP)),
+        ('HALF_GALLON_ML_FILL_TABLE', fill_table(half_gallon_widths, ML_IN_GAL // 2 // ML_STEP)),
+    ]
+
+    with open(out_path, 'w') as f:
+        f.write('// Generated by tools/fill_table.py, do not edit.\n')
+        f.write('#pragma once\n\n')
+        f.write('// Ounce tables are indexed by oz, mL tables by mL / FILL_TABLE_ML_STEP\n')
+        f.write('#define FILL_TABLE_ML_STEP {}\n'.format(ML_STEP))
+        f.write('// Rows at the top of the container that are never left out\n')
+        f.write('#define FILL_TABLE_MASK_TOP {}\n\n'.format(MASK_TOP))
+        f.write('\n\n'.join(_format_table(name, table) for name, table in tables))
+        f.write('\n')
+
+
+if __name__ == '__main__':
+    import sys
+    if len(sys.argv) != 6:
+        sys.exit('usage: fill_table.py OUT GALLON GALLON_FILLED HALF_GALLON HALF_GALLON_FILLED')
+    write_header(sys.argv[1], (sys.argv[2], sys.argv[3]), (sys.argv[4], sys.argv[5]))
@@ -0,0 +1,123 @@
+#include <pebble_worker.h>
+#include "../src/SharedState.h"
+#include "../src/Streaks.h"
+#include "../src/DayClock.h"
+#include "../src/DayRecord.h"
+#include "GallonWorker.h"
+
+// Set while the app owns the saved state, see WORKER_MSG_APP_OPENED
+static bool app_open = false;
+// When the saved day ends and when the next day's first reminder is due, in
+// UTC. Zero means nothing is due.
+static time_t next_reset, next_reminder;
+
+
+// Reads the snapshot the app saved. Snapshots from other versions are left
+// for the app to migrate.
+static bool load_state(PersistedState *state) {
+    int size = persist_read_data(STATE_KEY, state, sizeof(PersistedState));
+    return size == sizeof(PersistedState) && state->version == STATE_VERSION;
+}
+
+// Works out when the saved day ends. A day that already ended while the
+// worker wasn't running is rolled over on the next tick.
+static void plan_from_state() {
+    PersistedState state;
+    if (!load_state(&state)) {
+        next_reset = 0;
+        return;
+    }
+    day_clock_set_end_of_day(state.end_of_day);
+    uint32_t day = state.current_date / SEC_IN_DAY;
+    next_reset = (day + 1) * SEC_IN_DAY + state.end_of_day * SEC_IN_HOUR - day_clock_utc_offset();
+}
+
+// Does what the app's roll_over_day_if_needed() does, straight on the
+// snapshot, and plans the first reminder of the new day
+static void roll_over_day() {
+    PersistedState state;
+    if (!load_state(&state)) {
+        return;
+    }
+    day_clock_set_end_of_day(state.end_of_day);
+    time_t today = day_clock_now() - state.end_of_day * SEC_IN_HOUR;
+    if (state.current_date / SEC_IN_DAY != today / SEC_IN_DAY) {
+        // The worker's heap is small, so the stores are opened one at a time
+        state.total_drinks += day_record_finish_one_at_a_time(state.current_date / SEC_IN_DAY,
+            state.current_oz, state.current_ml, state.unit_system == METRIC, state.goal == HALF_GALLON);
+        state.days_logged++;
+        state.current_date = today;
+        state.current_oz = 0;
+        state.current_ml = 0;
+
+        streaks_init();
+        state.streak_count = streaks_current(day_clock_today());
+        streaks_deinit();
+        persist_write_data(STATE_KEY, &state, sizeof(state));
+
+        next_reminder = get_first_reminder_time(&state);
+    }
+    plan_from_state();
+}
+
+// Nothing has been drunk on a new day, so the only thing that can keep the
+// first reminder from going off is reminders being turned off
+static time_t get_first_reminder_time(const PersistedState *state) {
+    if (state->inactivity_reminder_hours == 0) {
+        return 0;
+    }
+    time_t local = day_clock_now();
+    time_t reminder = local - local % SEC_IN_DAY +
+        ((state->start_of_day + FIRST_REMINDER_DELAY_HOURS) % 24) * SEC_IN_HOUR;
+    if (reminder <= local) {
+        reminder += SEC_IN_DAY;
+    }
+    return reminder - day_clock_utc_offset();
+}
+
+static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
+    if (app_open) {
+        return;
+    }
+    time_t utc = time(NULL);
+    if (next_reset && utc >= next_reset) {
+        roll_over_day();
+    }
+    if (next_reminder && utc >= next_reminder) {
+        next_reminder = 0;
+        worker_launch_app();
+    }
+}
+
+static void app_message_handler(uint16_t type, AppWorkerMessage *data) {
+    if (type == WORKER_MSG_APP_OPENED) {
+        app_open = true;
+    } else if (type == WORKER_MSG_APP_CLOSED) {
+        // The app plans its own reminders whenever it runs, and the day or
+        // the end of day may have changed
+        app_open = false;
+        next_reminder = 0;
+        plan_from_state();
+    }
+}
+
+static void init(void) {
+    plan_from_state();
+    app_worker_message_subscribe(app_message_handler);
+    tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
+
+    // If the app is open, it answers with WORKER_MSG_APP_OPENED
+    AppWorkerMessage message = { 0 };
+    app_worker_send_message(WORKER_MSG_STARTED, &message);
+}
+
+static void deinit(void) {
+    tick_timer_service_unsubscribe();
+    app_worker_message_unsubscribe();
+}
+
+int main(void) {
+    init();
+    worker_event_loop();
+    deinit();
+}
@@ -0,0 +1,17 @@
+#ifndef GALLON_WORKER_HEADER
+#define GALLON_WORKER_HEADER
+
+// The first reminder of a day goes off this many hours after the start of
+// day hour, which is where the app's quiet hours end, see get_quiet_hours()
+#define FIRST_REMINDER_DELAY_HOURS 1
+
+static bool load_state(PersistedState *state);
+static void plan_from_state();
+static void roll_over_day();
+static time_t get_first_reminder_time(const PersistedState *state);
+static void tick_handler(struct tm *tick_time, TimeUnits units_changed);
+static void app_message_handler(uint16_t type, AppWorkerMessage *data);
+static void init(void);
+static void deinit(void);
+
+#endif